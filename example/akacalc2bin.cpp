@@ -0,0 +1,157 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Converts the AKACalc bond, call, put, sink, and coupon text files to
+   the binary column form of akacalc_binary.hpp.  Convert once, then
+   give the binary file to streamvalue (or any program reading bonds
+   through BondSource) in place of the text files.
+
+   Records which fail to parse are kept, with their error, so that the
+   programs reading the binary file still write one line per bond.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "akacalc_binary.hpp"
+
+/* forward declarations */
+void usage();
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *couponfile = NULL;
+    bool verbose = false;
+
+    while((c = getopt(argc, argv, "C:v"))!= EOF) {
+	switch(c) {
+	    case 'C' :
+		couponfile = optarg;
+		break;
+	    case 'v' :
+		verbose = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 2) {
+	usage();
+	return 1;
+    }
+    const char *outfile = argv[0];
+    const char *bondfile = argv[1];
+    const char *callfile = argc > 2 ? argv[2] : NULL;
+    const char *putfile = argc > 3 ? argv[3] : NULL;
+    const char *sinkfile = argc > 4 ? argv[4] : NULL;
+
+    BondSpecReader specs;
+    const char *failed = specs.Open(bondfile, callfile, putfile, sinkfile,
+				    couponfile);
+    if (failed != NULL) {
+	fprintf(stderr, "Error: unable to open %s\n", failed);
+	return 1;
+    }
+
+    BinaryBondWriter writer;
+    BondRecords recs;
+    long errors = 0;
+    while (specs.Next(recs)) {
+	if (!recs.error.empty()) {
+	    errors++;
+	    if (verbose)
+		fprintf(stderr, "%s: %s\n", recs.bond.key.c_str(),
+			recs.error.c_str());
+	}
+	writer.Add(recs);
+    }
+    if (!writer.Write(outfile)) {
+	fprintf(stderr, "Error: unable to write %s\n", outfile);
+	return 1;
+    }
+
+    printf("%llu bonds, %llu calls, %llu puts, %llu sinks, %llu coupons\n",
+	   (unsigned long long) writer.Count(BT_BOND),
+	   (unsigned long long) writer.Count(BT_CALL),
+	   (unsigned long long) writer.Count(BT_PUT),
+	   (unsigned long long) writer.Count(BT_SINK),
+	   (unsigned long long) writer.Count(BT_COUPON));
+    if (errors > 0)
+	fprintf(stderr, "Warning: %ld bonds with errors, kept with the "
+		"error%s\n", errors, verbose ? "" : " (-v lists them)");
+    if (specs.Orphans() > 0)
+	fprintf(stderr, "Warning: %ld option, sink, or coupon records "
+		"without a bond record\n", specs.Orphans());
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: convert AKACalc bond files to the binary column form\n");
+    printf("Usage: [FLAGS] <binary-file> <bond-file> "
+	   "[<call-file> [<put-file> [<sink-file>]]]\n");
+    printf("Use - in place of an unused call or put file name.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-C <coupon-file> -- step up/down coupon file\n"
+	"\t-v -- list the bonds with errors on stderr\n");
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
@@ -0,0 +1,516 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A binary, column oriented form of the AKACalc bond, call, put, sink,
+   and coupon files.  akacalc2bin converts the text files once; the
+   example programs then map the binary file into memory and build
+   bonds straight from the columns, with no parsing.
+
+   Layout, all numbers in the byte order of the writing machine:
+
+	BinaryHeader		magic, version, counts, column offsets
+	column ...		one array per field, each 64 byte aligned
+
+   There is one table for each text file.  Its columns hold one entry
+   per record, in the order of the text file, so the records of an
+   issue are contiguous.  The bond table has, for each child table, a
+   column of nbonds + 1 starting indexes: the calls of bond i are
+   entries first[i] up to first[i + 1] of the call columns.  Issue keys
+   and parse errors are offsets of NUL terminated strings in the string
+   column; offset 0 is the empty string.
+   ------------------------------------------------------------------------- */
+#ifndef _AKACALC_BINARY_HPP_
+#define _AKACALC_BINARY_HPP_
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX		/* keep std::min and std::max usable */
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "akacalc_files.hpp"
+
+#define BINARY_MAGIC		"AKACALCB"
+#define BINARY_VERSION		1
+#define BINARY_BYTEORDER	0x01020304
+#define BINARY_ALIGN		64
+
+enum BinaryTable {
+    BT_BOND, BT_CALL, BT_PUT, BT_SINK, BT_COUPON, BT_STRING, BINARY_TABLES
+};
+
+enum BinaryColumn {
+	/* bond table */
+    BC_KEY, BC_ERROR, BC_IDATE, BC_MDATE, BC_FCDATE, BC_LCDATE, BC_PAYDAY,
+    BC_COUPON, BC_YLD_METHOD, BC_EX_CPN_DAYS, BC_SIZE, BC_AMORTIZATION,
+    BC_FREQUENCY, BC_DAYCOUNT, BC_REDEMPTION, BC_ISSUE_PRICE, BC_ALLOCATION,
+    BC_FIRST_CALL, BC_FIRST_PUT, BC_FIRST_SINK, BC_FIRST_COUPON,
+	/* call and put tables */
+    BC_CALL_DATE, BC_CALL_TYPE, BC_CALL_PX, BC_CALL_DELAY,
+    BC_PUT_DATE, BC_PUT_TYPE, BC_PUT_PX, BC_PUT_DELAY,
+	/* sink table */
+    BC_SINK_DATE, BC_SINK_ACCELERATION, BC_SINK_PX, BC_SINK_AMT,
+    BC_SINK_DELIVERY,
+	/* coupon table */
+    BC_CPN_DATE, BC_CPN_CPN,
+	/* string table */
+    BC_STRINGS,
+    BINARY_COLUMNS
+};
+
+/* the table and element size of each column, in BinaryColumn order */
+struct BinaryColumnInfo {
+    int table;
+    int size;
+    bool first;		/* nbonds + 1 starting indexes into a child table */
+};
+
+inline const BinaryColumnInfo &
+binary_column(int col)
+{
+    static const BinaryColumnInfo columns[BINARY_COLUMNS] = {
+	{BT_BOND, 8, false}, {BT_BOND, 8, false}, {BT_BOND, 4, false},
+	{BT_BOND, 4, false}, {BT_BOND, 4, false}, {BT_BOND, 4, false},
+	{BT_BOND, 4, false}, {BT_BOND, 8, false}, {BT_BOND, 4, false},
+	{BT_BOND, 4, false}, {BT_BOND, 8, false}, {BT_BOND, 8, false},
+	{BT_BOND, 4, false}, {BT_BOND, 4, false}, {BT_BOND, 8, false},
+	{BT_BOND, 8, false}, {BT_BOND, 4, false},
+	{BT_BOND, 8, true}, {BT_BOND, 8, true}, {BT_BOND, 8, true},
+	{BT_BOND, 8, true},
+	{BT_CALL, 4, false}, {BT_CALL, 4, false}, {BT_CALL, 8, false},
+	{BT_CALL, 4, false},
+	{BT_PUT, 4, false}, {BT_PUT, 4, false}, {BT_PUT, 8, false},
+	{BT_PUT, 4, false},
+	{BT_SINK, 4, false}, {BT_SINK, 8, false}, {BT_SINK, 8, false},
+	{BT_SINK, 8, false}, {BT_SINK, 4, false},
+	{BT_COUPON, 4, false}, {BT_COUPON, 8, false},
+	{BT_STRING, 1, false}
+    };
+    return columns[col];
+}
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    uint64_t filesize;
+    uint64_t count[BINARY_TABLES];	/* records, bytes for strings */
+    uint64_t offset[BINARY_COLUMNS];
+};
+
+/* -----------------------------------------------------------------
+   Purpose: check whether a file starts with the binary magic number,
+	    so that programs can take either form of the bond file
+   Returns: true for a binary bond file
+   ----------------------------------------------------------------- */
+inline bool
+is_binary_bond_file(const char *fname)
+{
+    char magic[sizeof(BINARY_MAGIC) - 1];
+    FILE *fp = fopen(fname, "rb");
+    if (fp == NULL)
+	return false;
+    bool binary = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+	memcmp(magic, BINARY_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return binary;
+}
+
+/* -----------------------------------------------------------------
+   Collects BondRecords and writes the binary file.  The columns are
+   held in memory until Write(), about 100 bytes per bond plus 20 to
+   40 bytes per call, put, sink, or coupon record.
+   ----------------------------------------------------------------- */
+class BinaryBondWriter {
+private:     // disallow copy, assignment
+    BinaryBondWriter(const BinaryBondWriter &);
+    BinaryBondWriter & operator=(const BinaryBondWriter &);
+
+    std::vector<char> data[BINARY_COLUMNS];
+    uint64_t count[BINARY_TABLES];
+
+    template <class T>
+    void Put(int col, T value) {
+	const char *p = (const char *) &value;
+	data[col].insert(data[col].end(), p, p + sizeof(value));
+    };
+    uint64_t PutString(const std::string &s) {
+	if (s.empty())
+	    return 0;
+	uint64_t offset = data[BC_STRINGS].size();
+	data[BC_STRINGS].insert(data[BC_STRINGS].end(), s.begin(), s.end());
+	data[BC_STRINGS].push_back('\0');
+	return offset;
+    };
+    void PutOptions(int col, const std::vector<OptionRecord> &recs) {
+	for (size_t i = 0; i < recs.size(); i++) {
+	    Put<int32_t>(col, (int32_t) recs[i].date);
+	    Put<int32_t>(col + 1, (int32_t) recs[i].type);
+	    Put<double>(col + 2, recs[i].px);
+	    Put<int32_t>(col + 3, (int32_t) recs[i].delay);
+	}
+    };
+	// the starting indexes of the child tables for the next bond
+    void PutFirsts() {
+	Put<uint64_t>(BC_FIRST_CALL, count[BT_CALL]);
+	Put<uint64_t>(BC_FIRST_PUT, count[BT_PUT]);
+	Put<uint64_t>(BC_FIRST_SINK, count[BT_SINK]);
+	Put<uint64_t>(BC_FIRST_COUPON, count[BT_COUPON]);
+    };
+public:
+    BinaryBondWriter() {
+	memset(count, 0, sizeof(count));
+	data[BC_STRINGS].push_back('\0');
+	PutFirsts();
+    };
+
+    void Add(const BondRecords &recs) {
+	const BondRecord &b = recs.bond;
+	Put<uint64_t>(BC_KEY, PutString(b.key));
+	Put<uint64_t>(BC_ERROR, PutString(recs.error));
+	Put<int32_t>(BC_IDATE, (int32_t) b.idate);
+	Put<int32_t>(BC_MDATE, (int32_t) b.mdate);
+	Put<int32_t>(BC_FCDATE, (int32_t) b.fcdate);
+	Put<int32_t>(BC_LCDATE, (int32_t) b.lcdate);
+	Put<int32_t>(BC_PAYDAY, (int32_t) b.payday);
+	Put<double>(BC_COUPON, b.coupon);
+	Put<int32_t>(BC_YLD_METHOD, (int32_t) b.yld_method);
+	Put<int32_t>(BC_EX_CPN_DAYS, (int32_t) b.ex_cpn_days);
+	Put<double>(BC_SIZE, b.size);
+	Put<double>(BC_AMORTIZATION, b.amortization);
+	Put<int32_t>(BC_FREQUENCY, (int32_t) b.frequency);
+	Put<int32_t>(BC_DAYCOUNT, (int32_t) b.daycount);
+	Put<double>(BC_REDEMPTION, b.redemption);
+	Put<double>(BC_ISSUE_PRICE, b.issue_price);
+	Put<int32_t>(BC_ALLOCATION, (int32_t) b.allocation);
+
+	PutOptions(BC_CALL_DATE, recs.calls);
+	PutOptions(BC_PUT_DATE, recs.puts);
+	for (size_t i = 0; i < recs.sinks.size(); i++) {
+	    const SinkRecord &s = recs.sinks[i];
+	    Put<int32_t>(BC_SINK_DATE, (int32_t) s.date);
+	    Put<double>(BC_SINK_ACCELERATION, s.acceleration);
+	    Put<double>(BC_SINK_PX, s.px);
+	    Put<double>(BC_SINK_AMT, s.amt);
+	    Put<int32_t>(BC_SINK_DELIVERY, (int32_t) s.delivery);
+	}
+	for (size_t i = 0; i < recs.coupons.size(); i++) {
+	    Put<int32_t>(BC_CPN_DATE, (int32_t) recs.coupons[i].date);
+	    Put<double>(BC_CPN_CPN, recs.coupons[i].cpn);
+	}
+	count[BT_BOND]++;
+	count[BT_CALL] += recs.calls.size();
+	count[BT_PUT] += recs.puts.size();
+	count[BT_SINK] += recs.sinks.size();
+	count[BT_COUPON] += recs.coupons.size();
+	PutFirsts();
+    };
+
+    uint64_t Count(int table) const { return count[table]; };
+
+	// returns false if the file cannot be written
+    bool Write(const char *fname) {
+	BinaryHeader hdr;
+	static const char pad[BINARY_ALIGN] = {0};
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, BINARY_MAGIC, sizeof(hdr.magic));
+	hdr.version = BINARY_VERSION;
+	hdr.byteorder = BINARY_BYTEORDER;
+	memcpy(hdr.count, count, sizeof(count));
+	hdr.count[BT_STRING] = data[BC_STRINGS].size();
+	uint64_t offset = sizeof(hdr);
+	for (int col = 0; col < BINARY_COLUMNS; col++) {
+	    offset = (offset + BINARY_ALIGN - 1) / BINARY_ALIGN * BINARY_ALIGN;
+	    hdr.offset[col] = offset;
+	    offset += data[col].size();
+	}
+	hdr.filesize = offset;
+
+	FILE *fp = fopen(fname, "wb");
+	if (fp == NULL)
+	    return false;
+	bool good = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+	offset = sizeof(hdr);
+	for (int col = 0; good && col < BINARY_COLUMNS; col++) {
+	    size_t gap = (size_t) (hdr.offset[col] - offset);
+	    good = fwrite(pad, 1, gap, fp) == gap &&
+		(data[col].empty() ||
+		 fwrite(&data[col][0], data[col].size(), 1, fp) == 1);
+	    offset = hdr.offset[col] + data[col].size();
+	}
+	return fclose(fp) == 0 && good;
+    };
+};
+
+/* -----------------------------------------------------------------
+   A binary bond file mapped read-only into memory.  The columns can
+   be used in place through Column(), or one issue at a time through
+   Records() and the BondSource interface.  Records() may be called
+   from several threads at once.
+   ----------------------------------------------------------------- */
+class BinaryBondFile : public BondSource {
+private:     // disallow copy, assignment
+    BinaryBondFile(const BinaryBondFile &);
+    BinaryBondFile & operator=(const BinaryBondFile &);
+
+    const char *base;
+    uint64_t size;
+    const BinaryHeader *hdr;
+    uint64_t cursor;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+
+	// fill an option schedule from the call or put columns
+    void Options(int col, uint64_t first, uint64_t last,
+		 std::vector<OptionRecord> &recs) const {
+	const int32_t *date = Column<int32_t>(col);
+	const int32_t *type = Column<int32_t>(col + 1);
+	const double *px = Column<double>(col + 2);
+	const int32_t *delay = Column<int32_t>(col + 3);
+	recs.resize((size_t) (last - first));
+	for (uint64_t i = first; i < last; i++) {
+	    OptionRecord &r = recs[(size_t) (i - first)];
+	    r.date = date[i];
+	    r.type = type[i];
+	    r.px = px[i];
+	    r.delay = delay[i];
+	}
+    };
+
+	/* header, column bounds, child table indexes and string offsets,
+	   so a bad file fails here and not in Records() */
+    std::string Check() const {
+	if (size < sizeof(BinaryHeader) ||
+	    memcmp(hdr->magic, BINARY_MAGIC, sizeof(hdr->magic)) != 0)
+	    return "not a binary bond file";
+	if (hdr->version != BINARY_VERSION)
+	    return "unsupported binary bond file version";
+	if (hdr->byteorder != BINARY_BYTEORDER)
+	    return "binary bond file was written with another byte order";
+	if (hdr->filesize != size)
+	    return "binary bond file is truncated";
+	for (int col = 0; col < BINARY_COLUMNS; col++) {
+	    const BinaryColumnInfo &info = binary_column(col);
+	    uint64_t n = hdr->count[info.table] + (info.first ? 1 : 0);
+	    if (hdr->offset[col] % BINARY_ALIGN != 0 ||
+		hdr->offset[col] > size ||
+		n > (size - hdr->offset[col]) / info.size)
+		return "binary bond file column out of bounds";
+	}
+	if (hdr->count[BT_STRING] == 0 ||
+	    Column<char>(BC_STRINGS)[hdr->count[BT_STRING] - 1] != '\0')
+	    return "binary bond file string table is not terminated";
+	uint64_t nbonds = hdr->count[BT_BOND];
+	for (int k = 0; k < BT_STRING - BT_CALL; k++) {
+	    const uint64_t *first = Column<uint64_t>(BC_FIRST_CALL + k);
+	    if (first[0] != 0 || first[nbonds] != hdr->count[BT_CALL + k])
+		return "binary bond file child table index out of bounds";
+	    for (uint64_t i = 0; i < nbonds; i++)
+		if (first[i + 1] < first[i])
+		    return "binary bond file child table index out of order";
+	}
+	const uint64_t *key = Column<uint64_t>(BC_KEY);
+	const uint64_t *error = Column<uint64_t>(BC_ERROR);
+	for (uint64_t i = 0; i < nbonds; i++)
+	    if (key[i] >= hdr->count[BT_STRING] ||
+		error[i] >= hdr->count[BT_STRING])
+		return "binary bond file string offset out of bounds";
+	return "";
+    };
+public:
+    BinaryBondFile() : base(NULL), size(0), hdr(NULL), cursor(0) {
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+    };
+    ~BinaryBondFile() { Close(); };
+
+	// maps the file, returns the error or an empty string
+    std::string Open(const char *fname) {
+	Close();
+#ifdef _WIN32
+	file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+			   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	    return std::string("unable to open ") + fname;
+	LARGE_INTEGER len;
+	if (!GetFileSizeEx(file, &len) || len.QuadPart == 0) {
+	    Close();
+	    return "not a binary bond file";
+	}
+	size = (uint64_t) len.QuadPart;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+	    base = (const char *) MapViewOfFile(mapping, FILE_MAP_READ,
+						0, 0, 0);
+#else
+	int fd = open(fname, O_RDONLY);
+	if (fd < 0)
+	    return std::string("unable to open ") + fname;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+	    close(fd);
+	    return "not a binary bond file";
+	}
+	size = (uint64_t) st.st_size;
+	void *p = mmap(NULL, (size_t) size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p != MAP_FAILED) {
+	    base = (const char *) p;
+		/* read front to back by the valuation stages */
+	    madvise(p, (size_t) size, MADV_SEQUENTIAL);
+	}
+#endif
+	if (base == NULL) {
+	    Close();
+	    return std::string("unable to map ") + fname;
+	}
+	hdr = (const BinaryHeader *) base;
+	std::string error = Check();
+	if (!error.empty())
+	    Close();
+	return error;
+    };
+
+    void Close() {
+#ifdef _WIN32
+	if (base != NULL)
+	    UnmapViewOfFile(base);
+	if (mapping != NULL)
+	    CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+	    CloseHandle(file);
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	if (base != NULL)
+	    munmap((void *) base, (size_t) size);
+#endif
+	base = NULL;
+	hdr = NULL;
+	size = 0;
+	cursor = 0;
+    };
+
+	// records in a table, bytes for the string table
+    uint64_t Count(int table) const { return hdr->count[table]; };
+
+	// a column in place, T must match the column element size
+    template <class T>
+    const T *Column(int col) const {
+	return (const T *) (base + hdr->offset[col]);
+    };
+
+    const char *String(uint64_t offset) const {
+	return Column<char>(BC_STRINGS) + offset;
+    };
+    const char *Key(uint64_t i) const {
+	return String(Column<uint64_t>(BC_KEY)[i]);
+    };
+
+	// the records of bond i
+    void Records(uint64_t i, BondRecords &recs) const {
+	BondRecord &b = recs.bond;
+	b.key = Key(i);
+	recs.error = String(Column<uint64_t>(BC_ERROR)[i]);
+	b.idate = Column<int32_t>(BC_IDATE)[i];
+	b.mdate = Column<int32_t>(BC_MDATE)[i];
+	b.fcdate = Column<int32_t>(BC_FCDATE)[i];
+	b.lcdate = Column<int32_t>(BC_LCDATE)[i];
+	b.payday = Column<int32_t>(BC_PAYDAY)[i];
+	b.coupon = Column<double>(BC_COUPON)[i];
+	b.yld_method = Column<int32_t>(BC_YLD_METHOD)[i];
+	b.ex_cpn_days = Column<int32_t>(BC_EX_CPN_DAYS)[i];
+	b.size = Column<double>(BC_SIZE)[i];
+	b.amortization = Column<double>(BC_AMORTIZATION)[i];
+	b.frequency = Column<int32_t>(BC_FREQUENCY)[i];
+	b.daycount = Column<int32_t>(BC_DAYCOUNT)[i];
+	b.redemption = Column<double>(BC_REDEMPTION)[i];
+	b.issue_price = Column<double>(BC_ISSUE_PRICE)[i];
+	b.allocation = Column<int32_t>(BC_ALLOCATION)[i];
+
+	const uint64_t *first = Column<uint64_t>(BC_FIRST_CALL);
+	Options(BC_CALL_DATE, first[i], first[i + 1], recs.calls);
+	first = Column<uint64_t>(BC_FIRST_PUT);
+	Options(BC_PUT_DATE, first[i], first[i + 1], recs.puts);
+
+	first = Column<uint64_t>(BC_FIRST_SINK);
+	recs.sinks.resize((size_t) (first[i + 1] - first[i]));
+	for (uint64_t j = first[i]; j < first[i + 1]; j++) {
+	    SinkRecord &s = recs.sinks[(size_t) (j - first[i])];
+	    s.date = Column<int32_t>(BC_SINK_DATE)[j];
+	    s.acceleration = Column<double>(BC_SINK_ACCELERATION)[j];
+	    s.px = Column<double>(BC_SINK_PX)[j];
+	    s.amt = Column<double>(BC_SINK_AMT)[j];
+	    s.delivery = Column<int32_t>(BC_SINK_DELIVERY)[j];
+	}
+
+	first = Column<uint64_t>(BC_FIRST_COUPON);
+	recs.coupons.resize((size_t) (first[i + 1] - first[i]));
+	for (uint64_t j = first[i]; j < first[i + 1]; j++) {
+	    CouponRecord &c = recs.coupons[(size_t) (j - first[i])];
+	    c.date = Column<int32_t>(BC_CPN_DATE)[j];
+	    c.cpn = Column<double>(BC_CPN_CPN)[j];
+	}
+    };
+
+    using BondSource::Next;
+    bool Next(BondRecords &recs) {
+	if (hdr == NULL || cursor >= Count(BT_BOND))
+	    return false;
+	Records(cursor++, recs);
+	return true;
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: open the bond file of an example program, a text file with
+	    its call, put, sink, and coupon files, or a binary file,
+	    which holds them all; the unused names are NULL
+   Returns: text or binary, whichever was opened, or NULL with error
+	    set
+   ----------------------------------------------------------------- */
+inline BondSource *
+open_bond_source(const char *bondfile, const char *callfile,
+		 const char *putfile, const char *sinkfile,
+		 const char *couponfile, BondSpecReader &text,
+		 BinaryBondFile &binary, std::string &error)
+{
+    if (is_binary_bond_file(bondfile)) {
+	if (callfile != NULL || couponfile != NULL) {
+	    error = "a binary bond file holds its options, sinks, and coupons";
+	    return NULL;
+	}
+	error = binary.Open(bondfile);
+	return error.empty() ? &binary : NULL;
+    }
+    const char *failed = text.Open(bondfile, callfile, putfile, sinkfile,
+				   couponfile);
+    if (failed != NULL) {
+	error = std::string("unable to open ") + failed;
+	return NULL;
+    }
+    return &text;
+}
+
+#endif // ifndef _AKACALC_BINARY_HPP_
@@ -0,0 +1,906 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Readers for the AKACalc text data files.  The file formats are
+   described in doc/akacalc.overview.html.
+
+   All files are sorted by issue key (price files by date, then issue
+   key).  BondSpecReader merge-joins the bond file with the optional
+   call, put, sink, and coupon files and returns one AKABOND at a time,
+   so memory use does not grow with the size of the files.
+   ------------------------------------------------------------------------- */
+#ifndef _AKACALC_FILES_HPP_
+#define _AKACALC_FILES_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "akaapi.h"
+
+typedef std::vector<std::string> Fields;
+
+/* -----------------------------------------------------------------
+   Purpose: split a record into fields.  Fields are separated by white
+	    space, commas between fields are ignored, and double quoted
+	    strings may contain spaces, tabs, and commas.  A quoted string
+	    which is not closed runs to the end of the line.
+   Returns: number of fields
+   ----------------------------------------------------------------- */
+inline size_t
+split_fields(const char *line, Fields &fields)
+{
+    fields.clear();
+    const char *ptr = line;
+    for (;;) {
+	while (*ptr != '\0' && (isspace((int) *ptr) || *ptr == ','))
+	    ptr++;
+	if (*ptr == '\0')
+	    return fields.size();
+	std::string field;
+	if (*ptr == '"') {
+	    const char *end = strchr(++ptr, '"');
+	    if (end == NULL)
+		end = ptr + strlen(ptr);
+	    field.assign(ptr, end - ptr);
+	    ptr = (*end == '\0') ? end : end + 1;
+	}
+	else {
+	    const char *start = ptr;
+	    while (*ptr != '\0' && !isspace((int) *ptr) && *ptr != ',')
+		ptr++;
+	    field.assign(start, ptr - start);
+	}
+	fields.push_back(field);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: split a field into its colon separated parts, empty parts
+	    are kept, e.g., 20100630:::31
+   Returns: number of parts
+   ----------------------------------------------------------------- */
+inline size_t
+split_colons(const std::string &field, Fields &parts)
+{
+    parts.clear();
+    size_t start = 0;
+    for (;;) {
+	size_t colon = field.find(':', start);
+	if (colon == std::string::npos) {
+	    parts.push_back(field.substr(start));
+	    return parts.size();
+	}
+	parts.push_back(field.substr(start, colon - start));
+	start = colon + 1;
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: convert a whole field to a number
+   Returns: false if the field is empty or not entirely a number
+   ----------------------------------------------------------------- */
+inline bool
+field_double(const std::string &field, double *value)
+{
+    char *end;
+    if (field.empty())
+	return false;
+    *value = strtod(field.c_str(), &end);
+    return *end == '\0';
+}
+
+inline bool
+field_long(const std::string &field, long *value)
+{
+    char *end;
+    if (field.empty())
+	return false;
+    *value = strtol(field.c_str(), &end, 10);
+    return *end == '\0';
+}
+
+/* -----------------------------------------------------------------
+   A sorted data file read one record at a time with a one record
+   lookahead.  Blank lines are skipped.  A file that was never opened
+   behaves as an empty file, which is how the optional files work.
+   ----------------------------------------------------------------- */
+class RecordFile {
+private:     // disallow copy, assignment
+    RecordFile(const RecordFile &);
+    RecordFile & operator=(const RecordFile &);
+
+    FILE *fp;
+    std::string fname;
+    std::string line;
+    Fields fields;
+    long lineno;
+    bool have;
+
+	// read the next physical line, false at end of file
+    bool ReadLine() {
+	char buf[1024];
+	line.clear();
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+	    line += buf;
+	    if (!line.empty() && line[line.size() - 1] == '\n')
+		break;
+	}
+	return !line.empty();
+    };
+public:
+    RecordFile() : fp(NULL), lineno(0), have(false) {};
+    ~RecordFile() { Close(); };
+
+	// opens and reads the first record, false if it cannot be opened
+    bool Open(const char *name) {
+	Close();
+	fname = name;
+	fp = fopen(name, "r");
+	if (fp == NULL)
+	    return false;
+	Advance();
+	return true;
+    };
+
+    void Close() {
+	if (fp != NULL)
+	    fclose(fp);
+	fp = NULL;
+	have = false;
+	lineno = 0;
+    };
+
+	// move to the next non-blank record
+    void Advance() {
+	have = false;
+	while (fp != NULL && ReadLine()) {
+	    lineno++;
+	    if (split_fields(line.c_str(), fields) > 0) {
+		have = true;
+		break;
+	    }
+	}
+    };
+
+    bool Have() const { return have; };
+    const Fields &Current() const { return fields; };
+	// the issue key of the current record is its first field
+    const std::string &Key() const { return fields[0]; };
+    const char *Name() const { return fname.c_str(); };
+    long Line() const { return lineno; };
+};
+
+/* -----------------------------------------------------------------
+   A bond assembled from its records.  On failure bond is NULL and
+   error describes the problem.  The bond must be freed with
+   AKABondFree() by whoever ends up holding it.
+   ----------------------------------------------------------------- */
+struct BondSpec {
+    std::string key;
+    AKABOND *bond;
+    std::string error;
+
+    BondSpec() : bond(NULL) {};
+};
+
+/* -----------------------------------------------------------------
+   Purpose: convert the AKACalc frequency as a fraction of a year
+   Returns: AKAFrequency value, -1 if not a valid frequency
+   ----------------------------------------------------------------- */
+inline long
+akacalc_frequency(double years)
+{
+    if (years == 0)
+	return AKA_FREQ_INT_AT_MATURITY;
+    if (years >= .08 && years <= .085)
+	return AKA_FREQ_MONTHLY;
+    if (years == .25)
+	return AKA_FREQ_QUARTERLY;
+    if (years == .5)
+	return AKA_FREQ_SEMIANNUAL;
+    if (years == 1)
+	return AKA_FREQ_ANNUAL;
+    return -1;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: convert the AKACalc daycount, 0 through 4
+   Returns: AKADaycount value, -1 if not a valid daycount
+   ----------------------------------------------------------------- */
+inline long
+akacalc_daycount(long code)
+{
+    static const long daycounts[] = {
+	AKA_DAYS_30_360, AKA_DAYS_30E_360, AKA_DAYS_ACT_360,
+	AKA_DAYS_ACT_365, AKA_DAYS_ACT_ACT
+    };
+    if (code < 0 || code >= (long) (sizeof(daycounts) / sizeof(daycounts[0])))
+	return -1;
+    return daycounts[code];
+}
+
+/* -----------------------------------------------------------------
+   Purpose: convert the AKACalc yield method name
+   Returns: AKA_YIELD_METHOD value, -1 if not a valid name
+   ----------------------------------------------------------------- */
+inline long
+akacalc_yield_method(const std::string &name)
+{
+    if (name.empty() || name == "bey")
+	return AKA_YLD_BEY;
+    if (name == "period")
+	return AKA_YLD_SIMPLE_LAST_PERIOD;
+    if (name == "year")
+	return AKA_YLD_SIMPLE_LAST_YEAR;
+    if (name == "muni")
+	return AKA_YLD_MUNI;
+    return -1;
+}
+
+/* the fields of a bond record, before the AKABOND is allocated */
+struct BondRecord {
+    std::string key;
+    long idate, mdate, fcdate, lcdate, payday;
+    double coupon;
+    long yld_method, ex_cpn_days;
+    double size, amortization;
+    long frequency, daycount;
+    double redemption, issue_price;
+    long allocation;
+
+    BondRecord() : idate(0), mdate(0), fcdate(0), lcdate(0), payday(0),
+	coupon(0), yld_method(AKA_YLD_BEY), ex_cpn_days(0), size(0),
+	amortization(0), frequency(AKA_FREQ_SEMIANNUAL),
+	daycount(AKA_DAYS_30_360), redemption(100), issue_price(100),
+	allocation(AKA_ALLOC_PRORATA) {};
+};
+
+/* -----------------------------------------------------------------
+   Purpose: parse the fields of a bond record
+   Returns: empty string on success, else the error
+   ----------------------------------------------------------------- */
+inline std::string
+parse_bond_record(const Fields &f, BondRecord &rec)
+{
+    Fields parts;
+    double d;
+
+    if (f.size() < 7)
+	return "bond record has fewer than 7 fields";
+    rec.key = f[0];
+    if (!field_long(f[1], &rec.idate))
+	return "bad initial date";
+
+    split_colons(f[2], parts);
+    if (!field_long(parts[0], &rec.mdate))
+	return "bad maturity date";
+    if (parts.size() > 1 && !parts[1].empty() &&
+	!field_long(parts[1], &rec.fcdate))
+	return "bad first coupon date";
+    if (parts.size() > 2 && !parts[2].empty() &&
+	!field_long(parts[2], &rec.lcdate))
+	return "bad last coupon date";
+    if (parts.size() > 3 && !parts[3].empty() &&
+	!field_long(parts[3], &rec.payday))
+	return "bad payday";
+
+    split_colons(f[3], parts);
+    if (!field_double(parts[0], &rec.coupon))
+	return "bad coupon";
+    for (size_t i = 1; i < parts.size(); i++) {
+	long days;
+	if (field_long(parts[i], &days))
+	    rec.ex_cpn_days = days;
+	else if ((rec.yld_method = akacalc_yield_method(parts[i])) < 0)
+	    return "bad yield method";
+    }
+
+    split_colons(f[4], parts);
+    if (!field_double(parts[0], &rec.size))
+	return "bad issue size";
+    if (parts.size() > 1 && !parts[1].empty() &&
+	!field_double(parts[1], &rec.amortization))
+	return "bad amortization";
+
+    if (!field_double(f[5], &d) || (rec.frequency = akacalc_frequency(d)) < 0)
+	return "bad frequency";
+    long code;
+    if (!field_long(f[6], &code) || (rec.daycount = akacalc_daycount(code)) < 0)
+	return "bad daycount";
+
+	/* redemption value, issue price, designation; all optional */
+    int numbers = 0;
+    for (size_t i = 7; i < f.size(); i++) {
+	if (field_double(f[i], &d)) {
+	    if (numbers++ == 0)
+		rec.redemption = d;
+	    else
+		rec.issue_price = d;
+	}
+	else if (f[i] == "p")
+	    rec.allocation = AKA_ALLOC_PRORATA;
+	else if (f[i] == "f")
+	    rec.allocation = AKA_ALLOC_FRONT;
+	else if (f[i] == "b")
+	    rec.allocation = AKA_ALLOC_BACK;
+	else
+	    return "bad sinking fund designation";
+    }
+    return "";
+}
+
+/* the fields of a call or put record */
+struct OptionRecord {
+    long date, type;
+    double px;
+    long delay;
+
+    OptionRecord() : date(0), type(0), px(0), delay(0) {};
+};
+
+/* -----------------------------------------------------------------
+   Purpose: parse a call or put record: key date type price delay
+   Returns: empty string on success, else the error
+   ----------------------------------------------------------------- */
+inline std::string
+parse_option_record(const Fields &f, OptionRecord &rec)
+{
+    if (f.size() < 5)
+	return "option record has fewer than 5 fields";
+    if (!field_long(f[1], &rec.date))
+	return "bad option date";
+    if (!field_long(f[2], &rec.type) || rec.type < AKA_OPTION_EUROPEAN ||
+	rec.type > AKA_OPTION_BERMUDAN)
+	return "bad option type";
+    if (!field_double(f[3], &rec.px))
+	return "bad option price";
+    if (!field_long(f[4], &rec.delay))
+	return "bad option delay";
+    return "";
+}
+
+/* the fields of a sink record */
+struct SinkRecord {
+    long date;
+    double acceleration, px, amt;
+    long delivery;
+
+    SinkRecord() : date(0), acceleration(0), px(0), amt(0), delivery(0) {};
+};
+
+/* -----------------------------------------------------------------
+   Purpose: parse a sink record: key date acceleration price amount delivery
+   Returns: empty string on success, else the error
+   ----------------------------------------------------------------- */
+inline std::string
+parse_sink_record(const Fields &f, SinkRecord &rec)
+{
+    if (f.size() < 6)
+	return "sink record has fewer than 6 fields";
+    if (!field_long(f[1], &rec.date))
+	return "bad sink date";
+    if (!field_double(f[2], &rec.acceleration))
+	return "bad sink acceleration";
+    if (!field_double(f[3], &rec.px))
+	return "bad sink price";
+    if (!field_double(f[4], &rec.amt))
+	return "bad sink amount";
+    if (!field_long(f[5], &rec.delivery))
+	return "bad sink delivery";
+    return "";
+}
+
+/* the fields of a step coupon record */
+struct CouponRecord {
+    long date;
+    double cpn;
+
+    CouponRecord() : date(0), cpn(0) {};
+};
+
+/* -----------------------------------------------------------------
+   Purpose: parse a step coupon record: key date coupon
+   Returns: empty string on success, else the error
+   ----------------------------------------------------------------- */
+inline std::string
+parse_coupon_record(const Fields &f, CouponRecord &rec)
+{
+    if (f.size() < 3)
+	return "coupon record has fewer than 3 fields";
+    if (!field_long(f[1], &rec.date))
+	return "bad coupon date";
+    if (!field_double(f[2], &rec.cpn))
+	return "bad coupon";
+    return "";
+}
+
+/* -----------------------------------------------------------------
+   All the records of one issue, parsed but not yet an AKABOND.  If
+   any record failed to parse, error is set and the rest may be
+   incomplete.
+   ----------------------------------------------------------------- */
+struct BondRecords {
+    BondRecord bond;
+    std::vector<OptionRecord> calls, puts;
+    std::vector<SinkRecord> sinks;
+    std::vector<CouponRecord> coupons;
+    std::string error;
+
+    void Clear() {
+	bond = BondRecord();
+	calls.clear();
+	puts.clear();
+	sinks.clear();
+	coupons.clear();
+	error.clear();
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: fill an option schedule, all options of a schedule are
+	    expected to agree on the type and delay
+   ----------------------------------------------------------------- */
+inline void
+build_options(const std::vector<OptionRecord> &recs, AKAOPTION *opt)
+{
+    for (size_t i = 0; i < recs.size(); i++) {
+	opt->date[i] = recs[i].date;
+	opt->px[i] = recs[i].px;
+	opt->type = recs[i].type;
+	opt->delay = recs[i].delay;
+    }
+}
+
+/* -----------------------------------------------------------------
+   Mortgages made by AKABondMortgage(), kept by their terms.  A loan
+   tape holds many loans which differ only in amount, and
+   AKABondMortgage() builds each one's sink and call schedules flow by
+   flow.  The level payment, and so every scheduled principal
+   amount, is in proportion to the amount of the loan, so a loan whose
+   terms match a kept mortgage is a copy of it with the sink amounts
+   scaled, and AKABondMortgage() runs once per distinct terms.  Only
+   fixed coupon loans without call, put, or sink records of their own
+   are kept, up to a limit; the terms are those of the bond record.
+   The mortgages kept are bonds of the library, so Clear() must come
+   before AKA_shutdown().
+   ----------------------------------------------------------------- */
+class MortgageTemplates {
+private:     // disallow copy, assignment
+    MortgageTemplates(const MortgageTemplates &);
+    MortgageTemplates & operator=(const MortgageTemplates &);
+
+    struct Template {
+	double size;
+	AKABOND *bond;
+    };
+    std::map<std::string, Template> templates;
+    size_t limit;
+
+	// whether a loan is described by its bond record alone
+    static bool Plain(const BondRecords &recs) {
+	return recs.calls.empty() && recs.puts.empty() &&
+	    recs.sinks.empty() && recs.coupons.empty() &&
+	    recs.bond.size > 0;
+    };
+	// the terms of a loan other than its key and amount
+    static std::string Terms(const BondRecord &rec, double reficost) {
+	char buf[400];
+	snprintf(buf, sizeof(buf), "%ld %ld %ld %ld %ld %.17g %ld %ld %.17g "
+		 "%ld %ld %.17g %.17g %ld %.17g", rec.idate, rec.mdate,
+		 rec.fcdate, rec.lcdate, rec.payday, rec.coupon,
+		 rec.yld_method, rec.ex_cpn_days, rec.amortization,
+		 rec.frequency, rec.daycount, rec.redemption,
+		 rec.issue_price, rec.allocation, reficost);
+	return buf;
+    };
+public:
+    MortgageTemplates(size_t limit = 10000) : limit(limit) {};
+    ~MortgageTemplates() { Clear(); };
+
+    void Clear() {
+	std::map<std::string, Template>::iterator it;
+	for (it = templates.begin(); it != templates.end(); ++it)
+	    AKABondFree(it->second.bond);
+	templates.clear();
+    };
+
+	/* A new mortgage for the loan, copied from one with the same
+	   terms.  Returns NULL if there is none or the loan is not
+	   kept; the caller frees the bond returned. */
+    AKABOND *Copy(const BondRecords &recs, double reficost) const {
+	const BondRecord &rec = recs.bond;
+	if (!Plain(recs))
+	    return NULL;
+	std::map<std::string, Template>::const_iterator it =
+	    templates.find(Terms(rec, reficost));
+	if (it == templates.end())
+	    return NULL;
+	AKABOND *bond = AKABondCopy(it->second.bond);
+	if (bond == NULL)
+	    return NULL;
+	double scale = rec.size / it->second.size;
+	AKASINK *sink = bond->sink;
+	if (sink != NULL) {
+	    for (long i = 0; i < sink->n; i++)
+		sink->amt[i] *= scale;
+	    sink->face *= scale;
+	    sink->outstanding *= scale;
+	    sink->accumulation *= scale;
+	}
+	memset(bond->sec->name, 0, sizeof(bond->sec->name));
+	strncpy(bond->sec->name, rec.key.c_str(), sizeof(bond->sec->name) - 1);
+	return bond;
+    };
+
+	// keep a copy of the loan's mortgage, made by AKABondMortgage()
+    void Add(const BondRecords &recs, double reficost, const AKABOND *bond) {
+	const BondRecord &rec = recs.bond;
+	if (!Plain(recs) || templates.size() >= limit)
+	    return;
+	std::string terms = Terms(rec, reficost);
+	if (templates.find(terms) != templates.end())
+	    return;
+	Template t;
+	t.size = rec.size;
+	if ((t.bond = AKABondCopy(bond)) != NULL)
+	    templates[terms] = t;
+    };
+
+    size_t Size() const { return templates.size(); };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: allocate and fill the bond of an issue.  Bonds with an
+	    amortization are made mortgages with the refinancing cost,
+	    copied from templates when it has one with the same terms.
+   Returns: empty string on success, else the error with *out NULL
+   ----------------------------------------------------------------- */
+inline std::string
+build_bond(const BondRecords &recs, double reficost, AKABOND **out,
+	   MortgageTemplates *templates = NULL)
+{
+    const BondRecord &rec = recs.bond;
+
+    *out = NULL;
+    if (!recs.error.empty())
+	return recs.error;
+    if (rec.amortization > 0 && templates != NULL &&
+	(*out = templates->Copy(recs, reficost)) != NULL)
+	return "";
+    AKABOND *bond = AKABondAlloc((long) recs.coupons.size(),
+				 (long) recs.calls.size(),
+				 (long) recs.puts.size(),
+				 (long) recs.sinks.size());
+    if (bond == NULL)
+	return "bond allocation failed";
+    AKASECURITY *sec = bond->sec;
+    strncpy(sec->name, rec.key.c_str(), sizeof(sec->name) - 1);
+    sec->idate = rec.idate;
+    sec->ddate = rec.idate;
+    sec->mdate = rec.mdate;
+    sec->fcdate = rec.fcdate;
+    sec->lcdate = rec.lcdate;
+    sec->payday = rec.payday;
+    sec->coupon = rec.coupon;
+    sec->yld_method = rec.yld_method;
+    sec->ex_cpn_days = rec.ex_cpn_days;
+    sec->frequency = rec.frequency;
+    sec->daycount = rec.daycount;
+    sec->redemption_value = rec.redemption;
+    sec->issue_price = rec.issue_price;
+
+    build_options(recs.calls, bond->call);
+    build_options(recs.puts, bond->put);
+    for (size_t i = 0; i < recs.sinks.size(); i++) {
+	AKASINK *sink = bond->sink;
+	sink->date[i] = recs.sinks[i].date;
+	sink->px[i] = recs.sinks[i].px;
+	sink->amt[i] = recs.sinks[i].amt;
+	if (i == 0) {		/* first sink record sets these */
+	    sink->acceleration = recs.sinks[i].acceleration * 100;
+	    sink->delivery = recs.sinks[i].delivery;
+	    sink->allocation = rec.allocation;
+	    sink->face = rec.size;
+	}
+    }
+    for (size_t i = 0; i < recs.coupons.size(); i++) {
+	bond->cpn->type = AKA_PERIOD_BEGIN;
+	bond->cpn->date[i] = recs.coupons[i].date;
+	bond->cpn->cpn[i] = recs.coupons[i].cpn;
+    }
+    if (rec.amortization > 0 &&
+	AKABondMortgage(bond, rec.size, rec.amortization, reficost) !=
+	AKA_ERROR_NONE) {
+	AKABondFree(bond);
+	return AKAErrorString(AKAError());
+    }
+    if (rec.amortization > 0 && templates != NULL)
+	templates->Add(recs, reficost, bond);
+    *out = bond;
+    return "";
+}
+
+/* -----------------------------------------------------------------
+   A source of bonds in issue key order, the text files or their
+   binary form (see akacalc_binary.hpp).
+   ----------------------------------------------------------------- */
+class BondSource {
+protected:
+    double reficost;
+    MortgageTemplates mortgages;
+public:
+    BondSource() : reficost(0) {};
+    virtual ~BondSource() {};
+
+	/* Read the records of the next issue.  Returns false at the
+	   end.  An issue which fails to parse is still returned, with
+	   recs.error set. */
+    virtual bool Next(BondRecords &recs) = 0;
+
+	// records in the option, sink, and coupon files without a bond
+    virtual long Orphans() const { return 0; };
+
+	// refinancing cost applied to bonds with an amortization
+    void SetMortgageRefinanceCost(double cost) { reficost = cost; };
+
+	/* free the mortgages kept for copying; call it before
+	   AKA_shutdown(), the source may still be read after */
+    void Release() { mortgages.Clear(); };
+
+	/* Read the next bond.  Returns false at the end.  A bond which
+	   fails to parse or build is still returned, with spec.bond NULL
+	   and spec.error set, so that callers can write one output line
+	   per input record.  A mortgage is copied from an earlier loan
+	   of the same terms, see MortgageTemplates. */
+    bool Next(BondSpec &spec) {
+	BondRecords recs;
+	spec.bond = NULL;
+	spec.error.clear();
+	if (!Next(recs))
+	    return false;
+	spec.key = recs.bond.key;
+	spec.error = build_bond(recs, reficost, &spec.bond, &mortgages);
+	return true;
+    };
+};
+
+/* -----------------------------------------------------------------
+   Merge-join of the bond specification files.  The bond file drives
+   the join; records in the other files whose issue key has no bond
+   record are skipped and counted as orphans.
+   ----------------------------------------------------------------- */
+class BondSpecReader : public BondSource {
+private:     // disallow copy, assignment
+    BondSpecReader(const BondSpecReader &);
+    BondSpecReader & operator=(const BondSpecReader &);
+
+    RecordFile bonds, calls, puts, sinks, coupons;
+    long orphans;
+
+	// skip records keyed before key, parse those keyed at key
+    template <class R>
+    void Collect(RecordFile &file, const std::string &key,
+		 std::string (*parse)(const Fields &, R &),
+		 std::vector<R> &records, std::string &error) {
+	while (file.Have() && file.Key() < key) {
+	    orphans++;
+	    file.Advance();
+	}
+	while (file.Have() && file.Key() == key) {
+	    R rec;
+	    std::string err = parse(file.Current(), rec);
+	    if (err.empty())
+		records.push_back(rec);
+	    else if (error.empty())
+		error = err;
+	    file.Advance();
+	}
+    };
+	// optional files are skipped with NULL or "-"
+    static bool Used(const char *fname) {
+	return fname != NULL && strcmp(fname, "-") != 0;
+    };
+public:
+    BondSpecReader() : orphans(0) {};
+
+	/* Open the files, only the bond file is required, pass NULL or
+	   "-" for the files not used.  Returns the name of the file which
+	   could not be opened, or NULL on success. */
+    const char *Open(const char *bondfile, const char *callfile,
+		     const char *putfile, const char *sinkfile,
+		     const char *couponfile) {
+	if (!bonds.Open(bondfile))
+	    return bondfile;
+	if (Used(callfile) && !calls.Open(callfile))
+	    return callfile;
+	if (Used(putfile) && !puts.Open(putfile))
+	    return putfile;
+	if (Used(sinkfile) && !sinks.Open(sinkfile))
+	    return sinkfile;
+	if (Used(couponfile) && !coupons.Open(couponfile))
+	    return couponfile;
+	return NULL;
+    };
+
+    using BondSource::Next;
+    bool Next(BondRecords &recs) {
+	recs.Clear();
+	if (!bonds.Have())
+	    return false;
+	recs.bond.key = bonds.Key();
+	recs.error = parse_bond_record(bonds.Current(), recs.bond);
+	bonds.Advance();
+
+	const std::string &key = recs.bond.key;
+	Collect(calls, key, parse_option_record, recs.calls, recs.error);
+	Collect(puts, key, parse_option_record, recs.puts, recs.error);
+	Collect(sinks, key, parse_sink_record, recs.sinks, recs.error);
+	Collect(coupons, key, parse_coupon_record, recs.coupons, recs.error);
+	return true;
+    };
+
+    long Orphans() const { return orphans; };
+};
+
+
+/* -----------------------------------------------------------------
+   A price record: <date>[:<tradedate>] <issue key> <price>
+   [<outstanding amount>] [<position>]
+   ----------------------------------------------------------------- */
+struct PriceRecord {
+    long date;
+    long tradedate;
+    std::string key;
+    double price;
+    double outstanding;		/* -1 if not given */
+    double position;		/* 0 if not given */
+
+    PriceRecord() : date(0), tradedate(0), price(0), outstanding(-1),
+	position(0) {};
+};
+
+/* -----------------------------------------------------------------
+   Purpose: parse a price record
+   Returns: empty string on success, else the error
+   ----------------------------------------------------------------- */
+inline std::string
+parse_price_record(const Fields &f, PriceRecord &rec)
+{
+    Fields parts;
+    if (f.size() < 3)
+	return "price record has fewer than 3 fields";
+    split_colons(f[0], parts);
+    if (!field_long(parts[0], &rec.date))
+	return "bad price date";
+    rec.tradedate = 0;
+    if (parts.size() > 1 && !parts[1].empty() &&
+	!field_long(parts[1], &rec.tradedate))
+	return "bad trade date";
+    rec.key = f[1];
+    if (!field_double(f[2], &rec.price))
+	return "bad price";
+    rec.outstanding = -1;
+    if (f.size() > 3 && !field_double(f[3], &rec.outstanding))
+	return "bad outstanding amount";
+    rec.position = 0;
+    if (f.size() > 4 && !field_double(f[4], &rec.position))
+	return "bad position";
+    return "";
+}
+
+/* -----------------------------------------------------------------
+   The price records of one date, read in issue key order alongside
+   the bonds.  Records for earlier dates are skipped.
+   ----------------------------------------------------------------- */
+class PriceReader {
+private:     // disallow copy, assignment
+    PriceReader(const PriceReader &);
+    PriceReader & operator=(const PriceReader &);
+
+    RecordFile prices;
+    long pvdate;
+    PriceRecord current;
+    bool have;
+
+    void Load() {
+	have = false;
+	while (prices.Have()) {
+	    if (parse_price_record(prices.Current(), current).empty() &&
+		current.date >= pvdate) {
+		have = current.date == pvdate;
+		return;
+	    }
+	    prices.Advance();
+	}
+    };
+public:
+    PriceReader() : pvdate(0), have(false) {};
+
+    bool Open(const char *fname, long date) {
+	pvdate = date;
+	if (!prices.Open(fname))
+	    return false;
+	Load();
+	return true;
+    };
+
+	// find the price record for key, keys must be asked for in order
+    bool Find(const std::string &key, PriceRecord &rec) {
+	while (have && current.key < key) {
+	    prices.Advance();
+	    Load();
+	}
+	if (!have || current.key != key)
+	    return false;
+	rec = current;
+	return true;
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: read the yield curve for a date from an AKACalc yield file.
+	    The last curve dated on or before date is used.
+   Returns: allocated par curve, or NULL with the error set
+   ----------------------------------------------------------------- */
+inline AKACURVE *
+read_yield_curve(const char *fname, long date, std::string &error)
+{
+    RecordFile file;
+    std::vector<double> terms;
+    Fields best;
+
+    if (!file.Open(fname)) {
+	error = std::string("unable to open yield file ") + fname;
+	return NULL;
+    }
+    if (!file.Have()) {
+	error = "yield file is empty";
+	return NULL;
+    }
+    for (size_t i = 0; i < file.Current().size(); i++) {
+	double term;
+	if (!field_double(file.Current()[i], &term)) {
+	    error = "bad term in yield file term line";
+	    return NULL;
+	}
+	terms.push_back(term);
+    }
+    for (file.Advance(); file.Have(); file.Advance()) {
+	long curvedate;
+	if (!field_long(file.Current()[0], &curvedate) || curvedate > date)
+	    break;
+	best = file.Current();
+    }
+    if (best.empty()) {
+	error = "no yield curve on or before the pvdate";
+	return NULL;
+    }
+    if (best.size() != terms.size() + 3) {
+	error = "yield curve rates do not match the terms";
+	return NULL;
+    }
+
+    AKACURVE *curve = AKACurveAlloc((long) terms.size());
+    curve->mode = AKA_VOLMODE_MEANREV;
+    curve->type = AKA_CURVE_PAR;
+    bool good = field_double(best[1], &curve->vol) &&
+	field_double(best[2], &curve->alpha);
+    for (size_t i = 0; good && i < terms.size(); i++) {
+	curve->time[i] = terms[i];
+	good = field_double(best[i + 3], &curve->yield[i]);
+    }
+    if (!good) {
+	error = "bad number in yield curve";
+	curve = AKACurveFree(curve);
+    }
+    return curve;
+}
+
+#endif // ifndef _AKACALC_FILES_HPP_
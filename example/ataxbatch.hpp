@@ -0,0 +1,151 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   After-tax yields and bases of a book of tax lots, on several
+   threads.
+
+   AKAAtaxYield() and AKAAtaxBasis() take one lot at a time, with the
+   tax inputs filled into each report.  atax_batch() fills them from
+   the TaxContext of each lot (see taxcontext.hpp), or the one of the
+   whole book, so one book may hold lots of several brackets on the
+   same bonds.  The lots are taken a bond at a time, every lot of a
+   bond on one thread so the bond's data stays in its cache, and lots
+   of a bond bought on the same date at the same price in one bracket
+   share one AKAAtaxYield(), as do lots also sold alike for
+   AKAAtaxBasis().  The yield report holds the maturity, call and put
+   legs from one call.
+   ------------------------------------------------------------------------- */
+#ifndef _ATAXBATCH_HPP_
+#define _ATAXBATCH_HPP_
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+#include "akaapi.h"
+#include "taxcontext.hpp"
+#include "workqueue.hpp"
+
+/* a tax lot: its bond, its bracket, NULL for the book's, its purchase
+   and, if sale_date is not zero, its sale for the basis */
+struct AtaxLot {
+    const AKABOND *bond;
+    const TaxContext *tax;
+    long purchase_date;
+    double purchase_price;
+    long sale_date;
+    double sale_price;
+};
+
+/* the reports of a lot; basis is filled only for a lot with a sale */
+struct AtaxLotResult {
+    AKAATAXYLD yld;
+    AKAATAXBASIS basis;
+    enum AKA_ERROR_NUMBER error;
+};
+
+/* -----------------------------------------------------------------
+   Purpose: the reports of the lots order[first..last), all of one
+	    bond, sorted so that alike lots are next to each other
+   Returns: number of lots with an error
+   ----------------------------------------------------------------- */
+inline long
+atax_bond_lots(const AtaxLot *lots, const std::vector<size_t> &order,
+	       size_t first, size_t last, const TaxContext &book,
+	       AtaxLotResult *results)
+{
+    long failed = 0;
+    const AtaxLot *prev = NULL;
+    const AtaxLotResult *prevres = NULL;
+	/* the errors of prev's AKAAtaxYield() and AKAAtaxBasis() */
+    enum AKA_ERROR_NUMBER yielderr = AKA_ERROR_NONE;
+    enum AKA_ERROR_NUMBER basiserr = AKA_ERROR_NONE;
+
+    for (size_t k = first; k < last; k++) {
+	const AtaxLot &lot = lots[order[k]];
+	AtaxLotResult &res = results[order[k]];
+	const TaxContext &tax = lot.tax != NULL ? *lot.tax : book;
+	bool bought = prev != NULL &&
+	    (prev->tax != NULL ? *prev->tax : book) == tax &&
+	    prev->purchase_date == lot.purchase_date &&
+	    prev->purchase_price == lot.purchase_price;
+	bool sold = bought && prev->sale_date == lot.sale_date &&
+	    prev->sale_price == lot.sale_price;
+
+	memset(&res, 0, sizeof(res));
+	if (bought)
+	    res.yld = prevres->yld;
+	else {
+	    tax.Yield(lot.purchase_date, AKA_QUOTE_PRICE, lot.purchase_price,
+		      lot.bond, &res.yld);
+	    yielderr = AKAError();
+	    basiserr = AKA_ERROR_NONE;
+	}
+	res.error = yielderr;
+	if (yielderr == AKA_ERROR_NONE && lot.sale_date != 0) {
+	    if (sold)
+		res.basis = prevres->basis;
+	    else {
+		tax.Basis(lot.sale_date, AKA_QUOTE_PRICE, lot.sale_price,
+			  lot.purchase_date, lot.purchase_price, lot.bond,
+			  &res.basis);
+		basiserr = AKAError();
+	    }
+	    res.error = basiserr;
+	}
+	if (res.error != AKA_ERROR_NONE)
+	    failed++;
+	prev = &lot;
+	prevres = &res;
+    }
+    return failed;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the after-tax reports of n lots on nthreads threads, in
+	    the book's bracket unless a lot has its own.  results[i] is
+	    the reports of lots[i].  Bonds and contexts are only read,
+	    and may be shared with other threads.
+   Returns: number of lots with an error
+   ----------------------------------------------------------------- */
+inline long
+atax_batch(const AtaxLot *lots, size_t n, const TaxContext &book,
+	   int nthreads, AtaxLotResult *results)
+{
+	/* the lots of a bond together, alike lots next to each other */
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+	order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+	const AtaxLot &x = lots[a], &y = lots[b];
+	if (x.bond != y.bond)
+	    return std::less<const AKABOND *>()(x.bond, y.bond);
+	if (x.tax != y.tax)
+	    return std::less<const TaxContext *>()(x.tax, y.tax);
+	if (x.purchase_date != y.purchase_date)
+	    return x.purchase_date < y.purchase_date;
+	if (x.purchase_price != y.purchase_price)
+	    return x.purchase_price < y.purchase_price;
+	if (x.sale_date != y.sale_date)
+	    return x.sale_date < y.sale_date;
+	return x.sale_price < y.sale_price;
+    });
+    std::vector<size_t> starts;
+    for (size_t k = 0; k < n; k++)
+	if (k == 0 || lots[order[k]].bond != lots[order[k - 1]].bond)
+	    starts.push_back(k);
+    starts.push_back(n);
+
+    std::atomic<long> failed(0);
+    parallel_for((long) starts.size() - 1, nthreads, [&](long g, int) {
+	failed += atax_bond_lots(lots, order, starts[g], starts[g + 1],
+				 book, results);
+    });
+    return failed;
+}
+
+#endif // ifndef _ATAXBATCH_HPP_
@@ -0,0 +1,494 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   After-tax yields and bases of a book of municipal tax lots, on
+   several threads (see ataxbatch.hpp).
+
+   The lot file holds one record per lot, sorted by issue key like the
+   other AKACalc files:
+
+	key purchase-date purchase-price [income-tax-rate]
+
+   and an issue may have any number of lots.  A lot with an income tax
+   rate is valued in that bracket (see taxcontext.hpp), with the
+   capital gains rates of the flags, and the other lots in the bracket
+   of the flags.  A rate of zero would take the bond's own setting in
+   the library, so the rates of the lots and the flags must be above
+   zero.  The yields are those of the purchase.  With a price file,
+   each lot is also sold at the issue's price on the sale date for its
+   holder's basis and after-tax price.  Every lot is read before the
+   reports are run, and the bond file may be text or the binary form
+   written by akacalc2bin.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <list>
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "akacalc_binary.hpp"
+#include "ataxbatch.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+
+/* a record of the lot file, and the bond it resolved to */
+struct LotRecord {
+    std::string key;
+    long date;
+    double price;
+    double income;		/* -1 for the book's bracket */
+    std::string error;		/* empty if the lot has a bond */
+};
+
+/* -----------------------------------------------------------------
+   Purpose: read the lot file
+   Returns: empty string on success, else the error
+   ----------------------------------------------------------------- */
+static std::string
+read_lots(const char *fname, std::vector<LotRecord> &lots)
+{
+    RecordFile file;
+    if (!file.Open(fname))
+	return std::string("unable to open ") + fname;
+    for ( ; file.Have(); file.Advance()) {
+	const Fields &f = file.Current();
+	LotRecord lot;
+	lot.income = -1;
+	if (f.size() < 3 || !field_long(f[1], &lot.date) ||
+	    !field_double(f[2], &lot.price) ||
+	    (f.size() > 3 && (!field_double(f[3], &lot.income) ||
+			      lot.income <= 0))) {
+	    char buf[100];
+	    snprintf(buf, sizeof(buf), "bad lot record, line %ld",
+		     file.Line());
+	    if (f.size() > 3 && lot.income == 0)
+		return std::string(buf) + " of " + fname +
+		    ": an income tax rate must be above 0";
+	    return std::string(buf) + " of " + fname;
+	}
+	lot.key = f[0];
+	lots.push_back(lot);
+    }
+    return "";
+}
+
+/* -----------------------------------------------------------------
+   Purpose: parse the tax rate of a flag; zero is refused, the library
+	    would take the bond's rate in its place
+   Returns: false, with the error on stderr, if it is not above zero
+   ----------------------------------------------------------------- */
+static bool
+parse_rate(int flag, const char *arg, double *rate)
+{
+    char *end;
+    double r = strtod(arg, &end);
+    if (end == arg || *end != '\0' || !(r > 0)) {
+	fprintf(stderr, "Error: -%c %s: a tax rate must be above 0\n",
+		flag, arg);
+	return false;
+    }
+    *rate = r;
+    return true;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *couponfile = NULL;
+    const char *pricefile = NULL;
+    int nthreads = (int) std::thread::hardware_concurrency();
+    bool timing = false;
+    bool verify = false;
+    bool quiet = false;
+    TaxContext book;
+    while((c = getopt(argc, argv, "a:C:i:j:L:l:P:s:tvz"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'C' :
+		couponfile = optarg;
+		break;
+	    case 'i' :
+		if (!parse_rate(c, optarg, &book.income))
+		    return 1;
+		break;
+	    case 'j' :
+		nthreads = atoi(optarg);
+		break;
+	    case 'L' :
+		if (!parse_rate(c, optarg, &book.capgain_superlong))
+		    return 1;
+		break;
+	    case 'l' :
+		if (!parse_rate(c, optarg, &book.capgain_long))
+		    return 1;
+		break;
+	    case 'P' :
+		pricefile = optarg;
+		break;
+	    case 's' :
+		if (!parse_rate(c, optarg, &book.capgain_short))
+		    return 1;
+		break;
+	    case 't' :
+		timing = true;
+		break;
+	    case 'v' :
+		verify = true;
+		break;
+	    case 'z' :
+		quiet = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 3) {
+	usage();
+	return 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+
+    long saledate = akadatecnv(argv[0]);
+    const char *lotfile = argv[1];
+    const char *bondfile = argv[2];
+    const char *callfile = argc > 3 ? argv[3] : NULL;
+    const char *putfile = argc > 4 ? argv[4] : NULL;
+    const char *sinkfile = argc > 5 ? argv[5] : NULL;
+
+    init(keyfile);
+
+    std::vector<LotRecord> records;
+    std::string error = read_lots(lotfile, records);
+    if (!error.empty()) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+
+    BondSpecReader textspecs;
+    BinaryBondFile binspecs;
+    BondSource *specs = open_bond_source(bondfile, callfile, putfile,
+					 sinkfile, couponfile, textspecs,
+					 binspecs, error);
+    if (specs == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    PriceReader prices;
+    if (pricefile != NULL && !prices.Open(pricefile, saledate)) {
+	fprintf(stderr, "Error: unable to open %s\n", pricefile);
+	return 1;
+    }
+
+	/* join the lots to their bonds, both in key order */
+    clock_t start = clock();
+    std::vector<AKABOND *> bonds;
+    std::vector<AtaxLot> lots;
+    std::vector<size_t> lotrecord;
+    std::list<TaxContext> brackets;	/* one per income rate, shared */
+    size_t r = 0;
+    BondSpec spec;
+    while (r < records.size() && specs->Next(spec)) {
+	for ( ; r < records.size() && records[r].key < spec.key; r++)
+	    records[r].error = "no bond record";
+	PriceRecord price;
+	bool sold = pricefile != NULL && spec.bond != NULL &&
+	    prices.Find(spec.key, price);
+	for ( ; r < records.size() && records[r].key == spec.key; r++) {
+	    if (spec.bond == NULL) {
+		records[r].error = spec.error;
+		continue;
+	    }
+	    AtaxLot lot;
+	    lot.bond = spec.bond;
+	    lot.tax = NULL;
+	    if (records[r].income >= 0) {
+		TaxContext tax = book;
+		tax.income = records[r].income;
+		std::list<TaxContext>::iterator it = brackets.begin();
+		while (it != brackets.end() && *it != tax)
+		    ++it;
+		if (it == brackets.end())
+		    it = brackets.insert(it, tax);
+		lot.tax = &*it;
+	    }
+	    lot.purchase_date = records[r].date;
+	    lot.purchase_price = records[r].price;
+	    lot.sale_date = sold ? saledate : 0;
+	    lot.sale_price = sold ? price.price : 0;
+	    lots.push_back(lot);
+	    lotrecord.push_back(r);
+	}
+	if (spec.bond != NULL)
+	    bonds.push_back(spec.bond);
+    }
+    for ( ; r < records.size(); r++)
+	records[r].error = "no bond record";
+    double readsecs = INSECS(clock() - start);
+
+    start = clock();
+    time_t wallstart = time(NULL);
+    std::vector<AtaxLotResult> results(lots.size());
+    long failed = atax_batch(lots.empty() ? NULL : &lots[0], lots.size(),
+			     book, nthreads,
+			     results.empty() ? NULL : &results[0]);
+    double batchsecs = INSECS(clock() - start);
+    long wallsecs = (long) (time(NULL) - wallstart);
+
+	/* compare with a report run per lot */
+    double maxdiff = 0;
+    if (verify) {
+	for (size_t i = 0; i < lots.size(); i++) {
+	    const TaxContext &tax = lots[i].tax != NULL ? *lots[i].tax : book;
+	    AKAATAXYLD yld;
+	    tax.Yield(lots[i].purchase_date, AKA_QUOTE_PRICE,
+		      lots[i].purchase_price, lots[i].bond, &yld);
+	    if (AKAError() != AKA_ERROR_NONE ||
+		results[i].error != AKA_ERROR_NONE)
+		continue;
+	    maxdiff = std::max(maxdiff, fabs(yld.ytm.yield -
+					     results[i].yld.ytm.yield));
+	    if (lots[i].sale_date != 0) {
+		AKAATAXBASIS basis;
+		tax.Basis(lots[i].sale_date, AKA_QUOTE_PRICE,
+			  lots[i].sale_price, lots[i].purchase_date,
+			  lots[i].purchase_price, lots[i].bond, &basis);
+		double diff = basis.atax_price - results[i].basis.atax_price;
+		if (AKAError() == AKA_ERROR_NONE)
+		    maxdiff = std::max(maxdiff, fabs(diff));
+	    }
+	}
+    }
+
+    if (!quiet) {
+	size_t k = 0;
+	for (r = 0; r < records.size(); r++) {
+	    const LotRecord &rec = records[r];
+	    if (!rec.error.empty()) {
+		printf("%s %ld ERROR %s\n", rec.key.c_str(), rec.date,
+		       rec.error.c_str());
+		continue;
+	    }
+	    const AtaxLotResult &res = results[k];
+	    const AtaxLot &lot = lots[k++];
+	    if (res.error != AKA_ERROR_NONE) {
+		printf("%s %ld ERROR %s\n", rec.key.c_str(), rec.date,
+		       AKAErrorString(res.error));
+		continue;
+	    }
+	    printf("%s %ld %.6f %.6f %.6f", rec.key.c_str(), rec.date,
+		   res.yld.ytm.yield, res.yld.ytc.yield, res.yld.ytp.yield);
+	    if (lot.sale_date != 0)
+		printf(" %.6f %.6f", res.basis.holder_basis,
+		       res.basis.atax_price);
+	    printf("\n");
+	}
+    }
+
+    if (specs->Orphans() > 0)
+	fprintf(stderr, "Warning: %ld option, sink, or coupon records "
+		"without a bond record\n", specs->Orphans());
+    if (failed > 0)
+	fprintf(stderr, "Warning: %ld lots failed\n", failed);
+    if (verify)
+	fprintf(stderr, "largest difference from a report per lot = %g\n",
+		maxdiff);
+    if (timing)
+	fprintf(stderr, "%d lots, %d bonds, %d brackets, %d threads, "
+		"read cpu seconds = %0.2f, cpu seconds = %0.2f, "
+		"elapsed seconds = %ld\n", (int) lots.size(),
+		(int) bonds.size(), (int) brackets.size() + 1, nthreads,
+		readsecs, batchsecs, wallsecs);
+
+    for (size_t i = 0; i < bonds.size(); i++)
+	AKABondFree(bonds[i]);
+    specs->Release();
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: after-tax yields and bases of the tax lots of "
+	   "AKACalc bond files\n");
+    printf("Usage: [FLAGS] <saledate> <lot-file> <bond-file> "
+	   "[<call-file> [<put-file> [<sink-file>]]]\n");
+    printf("Use - in place of an unused call or put file name.\n");
+    printf("The lot file holds records of: key purchase-date "
+	   "purchase-price [income-tax-rate]\n");
+    printf("The bond file may be a binary file from akacalc2bin, "
+	   "without other files.\n");
+    printf("Tax rates must be above 0; the library takes 0 as the "
+	   "bond's rate.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-C <coupon-file> -- step up/down coupon file\n"
+	"\t-i <rate> -- income tax rate, default 35\n"
+	"\t-j <cnt> -- number of threads, default one per core\n"
+	"\t-L <rate> -- super long capital gains tax rate, default 15\n"
+	"\t-l <rate> -- long capital gains tax rate, default 15\n");
+    printf(
+	"\t-P <price-file> -- sell the lots at the prices for the saledate\n"
+	"\t-s <rate> -- short capital gains tax rate, default 35\n"
+	"\t-t -- display timings on stderr\n"
+	"\t-v -- verify against a report run per lot, on stderr\n"
+	"\t-z -- silent mode, no output, for timing\n");
+    printf(
+	"\nOutput, one line per lot record, in input order:\n"
+	"\tkey purchase-date ytm ytc ytp [holder-basis atax-price]\n"
+	"\tkey purchase-date ERROR message\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
@@ -0,0 +1,541 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Batch valuation of a serial issue.  Bonds are grouped by the tree
+   and OAS they are valued with and by daycount.  The members of a
+   serial issue share their flow dates: the flow-date grid of a shorter
+   maturity is the leading part of the grid of a longer one.  Each group
+   is valued as a unit:
+
+   - optionless members share the discount factors of the group's
+     flow-date grid, each factor is taken from the tree once, the
+     year fractions of a bond's new dates in one batch (see
+     serialdate.hpp); each bond's price is then a dot product of its
+     flows with the factors.
+   - members with options are valued on the lattice, one after the
+     other, so the shared tree stays warm.
+
+   The shared discounting is validated against AKABondPrice() on the
+   first optionless member of each flow shape in a group: its coupon
+   frequency, issue and first coupon dates, so an odd first coupon is
+   a shape of its own, and every bond with a coupon schedule.  A group
+   which does not agree to within 1e-6 falls back to the lattice for
+   the members after, and a member whose flows or accrued cannot be
+   had is valued there too.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "akaapi.h"
+#include "serialdate.hpp"
+
+/* forward declarations */
+void usage();
+int msgs();
+void init(const char *);
+long akadatecnv(const char *date);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+#define BATCH_TOLERANCE 1e-6
+
+/* one bond of the batch and its result */
+struct BatchBond {
+    const AKABOND *bond;	/* input */
+    AKAHTREE tree;		/* input */
+    double oas;			/* input */
+    double price;		/* output, -1 on failure */
+};
+
+/* grouping key -- bonds with equal keys share one set of discount factors */
+struct BatchKey {
+    AKAHTREE tree;
+    double oas;
+    long daycount;
+
+    bool operator <(const BatchKey &other) const {
+	if (tree != other.tree)
+	    return tree < other.tree;
+	if (oas != other.oas)
+	    return oas < other.oas;
+	return daycount < other.daycount;
+    }
+};
+
+/* discount factors of a group's flow-date grid, by date */
+typedef std::map<long, double> FactorMap;
+
+/* -----------------------------------------------------------------
+   Purpose: does the bond carry any option which requires the lattice
+   Returns: true if a call, put, or sink schedule is present
+   ----------------------------------------------------------------- */
+static bool
+has_options(const AKABOND *bond)
+{
+    return (bond->call != NULL && bond->call->n > 0) ||
+	(bond->put != NULL && bond->put->n > 0) ||
+	(bond->sink != NULL && bond->sink->n > 0);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: price an optionless bond from the group's discount factors,
+	    factors for dates not yet on the grid are added
+   Returns: clean price, -1 on failure
+   ----------------------------------------------------------------- */
+static double
+shared_price(long pvdate, const BatchKey &key, const AKABOND *bond,
+	     AKAFLOWREPORT *flows, FactorMap &factors)
+{
+    if (AKABondFlowOnly(pvdate, bond, flows) != 0 ||
+	AKAError() != AKA_ERROR_NONE)
+	return -1;
+
+	/* the year fractions of the dates new to the grid in one batch */
+    std::vector<long> dates;
+    for (long i = 0; i < flows->nFlows; i++)
+	if (factors.find(flows->date[i]) == factors.end())
+	    dates.push_back(flows->date[i]);
+    if (!dates.empty()) {
+	std::vector<double> years(dates.size());
+	years_batch(pvdate, &dates[0], dates.size(), key.daycount,
+		    &years[0]);
+	for (size_t i = 0; i < dates.size(); i++)
+	    factors[dates[i]] = AKADiscount(key.tree, key.oas, 1.0, years[i]);
+    }
+
+    double dirty = 0;
+    for (long i = 0; i < flows->nFlows; i++)
+	dirty += flows->tflow[i] * factors[flows->date[i]];
+    double accrued = AKABondAccrued(pvdate, bond);
+    if (accrued < 0)
+	return -1;
+    return dirty - accrued;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the shape of a bond's flows, for validating it
+   Returns: a key equal for bonds whose flows differ only in their
+	    maturity and amounts; a coupon schedule makes its own
+   ----------------------------------------------------------------- */
+static std::string
+flow_shape(const AKABOND *bond)
+{
+    const AKASECURITY *sec = bond->sec;
+    char buf[100];
+    if (bond->cpn != NULL && bond->cpn->n > 0)
+	snprintf(buf, sizeof(buf), "schedule %p", (const void *) bond);
+    else
+	snprintf(buf, sizeof(buf), "%ld %ld %ld", sec->frequency,
+		 sec->idate, sec->fcdate);
+    return buf;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: value one group of bonds sharing tree, oas and daycount
+   Returns: number of bonds valued on the lattice
+   ----------------------------------------------------------------- */
+static int
+value_group(long pvdate, const BatchKey &key, const std::vector<int> &members,
+	    BatchBond *bonds)
+{
+    int lattice = 0;
+    std::vector<int> optionless;
+
+    for (size_t i = 0; i < members.size(); i++) {
+	BatchBond &b = bonds[members[i]];
+	if (has_options(b.bond)) {
+	    b.price = AKABondPrice(pvdate, b.tree, b.bond, b.oas);
+	    lattice++;
+	}
+	else
+	    optionless.push_back(members[i]);
+    }
+    if (optionless.empty())
+	return lattice;
+
+    AKAFLOWREPORT *flows = AKAFlowReportAlloc();
+    FactorMap factors;
+    std::set<std::string> shapes;
+    bool shared = true;
+    for (size_t i = 0; i < optionless.size(); i++) {
+	BatchBond &b = bonds[optionless[i]];
+	if (shared) {
+	    b.price = shared_price(pvdate, key, b.bond, flows, factors);
+	    if (shapes.insert(flow_shape(b.bond)).second) {
+		    /* validate each shape against the lattice */
+		double check = AKABondPrice(pvdate, b.tree, b.bond, b.oas);
+		lattice++;
+		if (b.price < 0 || fabs(check - b.price) > BATCH_TOLERANCE) {
+		    shared = false;
+		    b.price = check;
+		}
+	    }
+	    else if (b.price < 0) {	/* its flows failed, not the group */
+		b.price = AKABondPrice(pvdate, b.tree, b.bond, b.oas);
+		lattice++;
+	    }
+	}
+	else {
+	    b.price = AKABondPrice(pvdate, b.tree, b.bond, b.oas);
+	    lattice++;
+	}
+    }
+    AKAFlowReportFree(flows);
+    return lattice;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: value a batch of bonds grouped by tree, oas and daycount
+   Returns: number of groups, the price of each bond is set
+   ----------------------------------------------------------------- */
+int
+batch_value(long pvdate, BatchBond *bonds, int n, int *lattice_count)
+{
+    typedef std::map<BatchKey, std::vector<int> > GroupMap;
+    GroupMap groups;
+
+    for (int i = 0; i < n; i++) {
+	bonds[i].price = -1;
+	BatchKey key;
+	key.tree = bonds[i].tree;
+	key.oas = bonds[i].oas;
+	key.daycount = bonds[i].bond->sec->daycount;
+	groups[key].push_back(i);
+    }
+
+    int lattice = 0;
+    for (GroupMap::const_iterator g = groups.begin(); g != groups.end(); ++g)
+	lattice += value_group(pvdate, g->first, g->second, bonds);
+    if (lattice_count != NULL)
+	*lattice_count = lattice;
+    return (int) groups.size();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: build a serial issue, one bond per maturity year; bonds
+	    maturing after the call date carry a par call
+   Returns: number of bonds allocated into bonds
+   ----------------------------------------------------------------- */
+static int
+make_serial(long ddate, int maturities, int cusips, int callyears,
+	    std::vector<AKABOND *> &bonds)
+{
+    long cdate = ddate + callyears * 10000L;
+    for (int m = 1; m <= maturities; m++) {
+	for (int c = 0; c < cusips; c++) {
+	    long mdate = ddate + m * 10000L;
+	    bool callable = callyears > 0 && mdate > cdate;
+	    AKABOND *bond = AKABondAlloc(0, callable ? 1 : 0, 0, 0);
+	    sprintf(bond->sec->name, "serial-%02d-%d", m, c);
+	    bond->sec->ddate = ddate;
+	    bond->sec->mdate = mdate;
+	    bond->sec->coupon = 2.0 + .125 * m + .05 * c;
+	    bond->sec->daycount = AKA_DAYS_30_360;
+	    bond->sec->frequency = AKA_FREQ_SEMIANNUAL;
+	    bond->sec->yld_method = AKA_YLD_MUNI;
+	    if (callable) {
+		bond->call->type = AKA_OPTION_AMERICAN;
+		bond->call->delay = 30;
+		bond->call->date[0] = cdate;
+		bond->call->px[0] = 100;
+	    }
+	    bonds.push_back(bond);
+	}
+    }
+    return (int) bonds.size();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    long pvdate = 20140701;
+    long ddate = 20140101;
+    int maturities = 30;
+    int cusips = 1;
+    int callyears = 10;
+    double vol = 10;
+    double oas = 0;
+    bool quiet = false;
+
+    while((c = getopt(argc, argv, "a:c:d:m:n:o:p:v:z"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'c' :
+		callyears = atoi(optarg);
+		break;
+	    case 'd' :
+		ddate = akadatecnv(optarg);
+		break;
+	    case 'm' :
+		maturities = atoi(optarg);
+		break;
+	    case 'n' :
+		cusips = atoi(optarg);
+		break;
+	    case 'o' :
+		oas = atof(optarg);
+		break;
+	    case 'p' :
+		pvdate = akadatecnv(optarg);
+		break;
+	    case 'v' :
+		vol = atof(optarg);
+		break;
+	    case 'z' :
+		quiet = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    if (maturities < 1 || cusips < 1) {
+	usage();
+	return 1;
+    }
+
+    init(keyfile);
+
+    static double terms[] = { .5, 1, 2, 3, 5, 7, 10, 20, 30 };
+    static double rates[] = { .45, .55, .8, 1.1, 1.6, 2.1, 2.6, 3.3, 3.6 };
+    AKACURVE *curve = AKACurveAlloc(sizeof(terms) / sizeof(terms[0]));
+    for (long i = 0; i < curve->n; i++) {
+	curve->time[i] = terms[i];
+	curve->yield[i] = rates[i];
+    }
+    curve->mode = AKA_VOLMODE_MEANREV;
+    curve->type = AKA_CURVE_PAR;
+    curve->vol = vol;
+    AKAHTREE htree = AKATreeFit(curve, NULL);
+    AKACurveFree(curve);
+    if (!msgs())
+	return 1;
+
+    std::vector<AKABOND *> cbonds;
+    int n = make_serial(ddate, maturities, cusips, callyears, cbonds);
+    std::vector<BatchBond> batch(n);
+    for (int i = 0; i < n; i++) {
+	batch[i].bond = cbonds[i];
+	batch[i].tree = htree;
+	batch[i].oas = oas;
+    }
+
+	/* one call per bond, as a baseline */
+    std::vector<double> single(n);
+    clock_t start = clock();
+    for (int i = 0; i < n; i++)
+	single[i] = AKABondPrice(pvdate, htree, cbonds[i], oas);
+    clock_t single_ticks = clock() - start;
+
+    int lattice = 0;
+    start = clock();
+    int ngroups = batch_value(pvdate, &batch[0], n, &lattice);
+    clock_t batch_ticks = clock() - start;
+
+    double maxdiff = 0;
+    for (int i = 0; i < n; i++) {
+	double diff = fabs(batch[i].price - single[i]);
+	if (diff > maxdiff)
+	    maxdiff = diff;
+	if (!quiet)
+	    printf("%-16s %8ld %8.4f %10.4f\n", cbonds[i]->sec->name,
+		   cbonds[i]->sec->mdate, cbonds[i]->sec->coupon,
+		   batch[i].price);
+    }
+    printf("%d bonds in %d groups, %d lattice valuations\n",
+	   n, ngroups, lattice);
+    printf("Seconds one call per bond = %0.3f, batched = %0.3f\n",
+	   INSECS(single_ticks), INSECS(batch_ticks));
+    printf("Largest difference from AKABondPrice() = %g\n", maxdiff);
+
+    for (int i = 0; i < n; i++)
+	AKABondFree(cbonds[i]);
+    AKATreeRelease(htree);
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: value a serial issue, sharing discount factors across "
+	   "the issue\n");
+    printf("Usage: [FLAGS]\n");
+    printf("The shared prices are checked on the lattice for one bond of "
+	   "each flow shape.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-c <years> -- par call after years, 0 for no calls, default 10\n"
+	"\t-d <ddate> -- dated date of the issue, default 1/1/2014\n"
+	"\t-m <cnt> -- number of serial maturities, default 30\n");
+    printf(
+	"\t-n <cnt> -- bonds (coupons) per maturity, default 1\n"
+	"\t-o <oas> -- oas used for all bonds, default 0\n"
+	"\t-p <pvdate> -- pvdate, default 7/1/2014\n"
+	"\t-v <vol> -- set curve volatility, default 10\n"
+	"\t-z -- do not list the individual bond prices\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: pop all the messages of the stack and put them out
+   Returns: 1 if no errors else 0
+   ----------------------------------------------------------------- */
+int
+msgs()
+{
+    enum AKA_ERROR_NUMBER errornumber = AKAError();
+    enum AKA_ERROR_NUMBER warnings[AKA_WARNINGS_MAX];
+    int wcnt = AKAWarnings(warnings);
+    int i;
+    for (i = 0; i < wcnt; i++)
+	fprintf(stdout, "%2d \"%s\"\n", 2, AKAErrorString(warnings[i]));
+    if (errornumber > AKA_ERROR_NONE)
+    	fprintf(stdout, "%2d \"%s\"\n", 3, AKAErrorString(errornumber));
+    return errornumber == AKA_ERROR_NONE;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
@@ -0,0 +1,559 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Benchmarks of the library entry points over fixed synthetic
+   portfolios (see benchportfolio.hpp), on one thread and on several.
+
+   Each benchmark times one library call per bond of a portfolio kind.
+   The output is CSV, one row per benchmark, kind, and thread count.
+   Run the same build of this program against two library releases
+   and compare the rows.  The checksum column is the sum of a result of
+   each call, added in bond order, so it does not depend on the thread
+   count; a change in it between releases means the numbers changed,
+   not only the speed.
+
+     make -f Makefile.gmake ARCH=<arch> bench
+
+   runs the full set and writes benchmark.<arch>.csv.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "benchportfolio.hpp"
+#include "workqueue.hpp"
+#include "zspread.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+
+/* state shared read-only by the benchmark threads */
+struct BenchContext {
+    long pvdate;
+    AKACURVE *curve;
+    AKAHTREE tree;
+    AKAHTREE zerotree;		/* AKATreeFitZero(), for Z-spreads */
+    AKAKRDURSETUP *krsetup;
+    AKASCENSETUP *scen;
+};
+
+/* one library call for a bond, false on a library error */
+typedef bool (*BenchOp)(const BenchContext *ctx, const BenchBond *b,
+			double *result);
+
+static bool
+no_error()
+{
+    return AKAError() == AKA_ERROR_NONE;
+}
+
+static bool
+op_treefit(const BenchContext *ctx, const BenchBond *, double *result)
+{
+    AKAHTREE tree = AKATreeFit(ctx->curve, NULL);
+    if (tree == 0)
+	return false;
+    *result = AKADiscount(tree, 0, 100, 10);
+    AKATreeRelease(tree);
+    return true;
+}
+
+static bool
+op_price(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    *result = AKABondPrice(ctx->pvdate, ctx->tree, b->bond, b->oas);
+    return no_error();
+}
+
+static bool
+op_oas(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    *result = AKABondOAS(ctx->pvdate, ctx->tree, b->bond, b->price);
+    return no_error();
+}
+
+static bool
+op_zspread_oas(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    *result = AKABondOAS(ctx->pvdate, ctx->zerotree, b->bond, b->price);
+    return no_error();
+}
+
+static bool
+op_zspread(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    ZSpreadFlows f;
+    if (!zspread_prepare(ctx->pvdate, ctx->zerotree, b->bond, f))
+	return false;
+    *result = zspread_solve(ctx->zerotree, f, b->price);
+    return *result != ZSPREAD_ERROR;
+}
+
+static bool
+op_bondval3(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    AKABONDREPORT rpt;
+    memset(&rpt, 0, sizeof(rpt));
+    AKABondVal3(ctx->pvdate, AKA_QUOTE_PRICE, b->price, ctx->tree, b->bond,
+		&rpt, NULL,
+		AKABONDVAL_DURATION | AKABONDVAL_OPTION | AKABONDVAL_YIELDS);
+    *result = rpt.oas + rpt.effDur;
+    return no_error();
+}
+
+static bool
+op_keydur(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    AKAKRDURREPORT *rpt = AKABondKeyDur3(ctx->pvdate, b->bond,
+					 AKA_QUOTE_PRICE, b->price,
+					 ctx->krsetup);
+    if (rpt == NULL)
+	return false;
+    *result = 0;
+    for (long i = 0; i < rpt->n; i++)
+	*result += rpt->durs[i];
+    AKAKRDurReportFree(rpt);
+    return true;
+}
+
+static bool
+op_scenario(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    AKASCENREPORT rpt;
+    double efficiency;
+    memset(&rpt, 0, sizeof(rpt));
+    AKABondScenEx(AKA_QUOTE_PRICE, b->price, ctx->scen, b->bond, &rpt,
+		  &efficiency);
+    *result = rpt.totalRet;
+    return no_error();
+}
+
+static bool
+op_ytw(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    AKAYLDWORST *rpt = AKAYieldToWorstEx2(ctx->pvdate, AKA_QUOTE_PRICE,
+					  b->price, b->bond, 0, 0);
+    if (rpt == NULL)
+	return false;
+    *result = rpt->n > 0 ? rpt->yields[rpt->worst] : 0;
+    AKAYldWorstReportFree(rpt);
+    return true;
+}
+
+static bool
+op_atax(const BenchContext *ctx, const BenchBond *b, double *result)
+{
+    AKAATAXYLD rpt;
+    memset(&rpt, 0, sizeof(rpt));
+    rpt.taxrate_income = 35;
+    rpt.taxrate_short = 35;
+    rpt.taxrate_long = 15;
+    rpt.taxrate_superlong = 15;
+    AKAAtaxYield(ctx->pvdate, AKA_QUOTE_PRICE, b->price, b->bond, &rpt);
+    *result = rpt.ytm.yield;
+    return no_error();
+}
+
+#define ALL_KINDS ((1 << BENCH_KINDS) - 1)
+
+static const struct Benchmark {
+    const char *name;
+    BenchOp op;
+    int kinds;		/* mask of the kinds run, 0 for the curve only */
+} benchmarks[] = {
+    {"treefit", op_treefit, 0},
+    {"price", op_price, ALL_KINDS},
+    {"oas", op_oas, ALL_KINDS},
+    {"zspread_oas", op_zspread_oas, ALL_KINDS},
+    {"zspread", op_zspread, ALL_KINDS},
+    {"bondval3", op_bondval3, ALL_KINDS},
+    {"keydur", op_keydur, ALL_KINDS},
+    {"scenario", op_scenario, ALL_KINDS},
+    {"ytw", op_ytw, ALL_KINDS},
+    {"atax", op_atax, 1 << BENCH_MUNI}
+};
+#define NBENCHMARKS ((int) (sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+/* -----------------------------------------------------------------
+   Purpose: run op over the items on nthreads threads, the threads
+	    take the next item from a shared counter
+   Returns: elapsed seconds, results and errors are filled in
+   ----------------------------------------------------------------- */
+static double
+bench_run(const BenchContext *ctx, BenchOp op,
+	  const std::vector<const BenchBond *> &items, int nthreads,
+	  std::vector<double> &results, long *errors)
+{
+    std::atomic<long> failed(0);
+
+    results.assign(items.size(), 0);
+    std::chrono::steady_clock::time_point start =
+	std::chrono::steady_clock::now();
+    parallel_for((long) items.size(), nthreads, [&](long i, int) {
+	if (!op(ctx, items[i], &results[i])) {
+	    results[i] = 0;
+	    failed++;
+	}
+    });
+    std::chrono::duration<double> elapsed =
+	std::chrono::steady_clock::now() - start;
+    *errors = failed;
+    return elapsed.count();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: parse a comma separated list of positive integers
+   Returns: false on a bad list
+   ----------------------------------------------------------------- */
+static bool
+parse_counts(const char *list, std::vector<int> &counts)
+{
+    counts.clear();
+    while (*list != '\0') {
+	char *end;
+	long n = strtol(list, &end, 10);
+	if (end == list || n <= 0 || (*end != ',' && *end != '\0'))
+	    return false;
+	counts.push_back((int) n);
+	list = (*end == ',') ? end + 1 : end;
+    }
+    return !counts.empty();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: is the benchmark in the comma separated list of names
+   Returns: true if selected, everything is selected by a NULL list
+   ----------------------------------------------------------------- */
+static bool
+selected(const char *list, const char *name)
+{
+    if (list == NULL)
+	return true;
+    size_t len = strlen(name);
+    for (const char *p = strstr(list, name); p != NULL;
+	 p = strstr(p + 1, name)) {
+	if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0'))
+	    return true;
+    }
+    return false;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *names = NULL;
+    const char *outfile = NULL;
+    int hwthreads = (int) std::thread::hardware_concurrency();
+    std::vector<int> threadcounts;
+    int count = 100;
+    int nfits = 20;
+    int reps = 3;
+
+    if (hwthreads < 1)
+	hwthreads = 1;
+    threadcounts.push_back(1);
+    if (hwthreads > 1)
+	threadcounts.push_back(hwthreads);
+
+    while((c = getopt(argc, argv, "a:b:f:j:n:o:r:"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'b' :
+		names = optarg;
+		break;
+	    case 'f' :
+		nfits = atoi(optarg);
+		break;
+	    case 'j' :
+		if (!parse_counts(optarg, threadcounts)) {
+		    fprintf(stderr, "Error: bad thread counts %s\n", optarg);
+		    return 1;
+		}
+		break;
+	    case 'n' :
+		count = atoi(optarg);
+		break;
+	    case 'o' :
+		outfile = optarg;
+		break;
+	    case 'r' :
+		reps = atoi(optarg);
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    if (count < 1 || nfits < 1 || reps < 1) {
+	usage();
+	return 1;
+    }
+    int nselected = 0;
+    for (int i = 0; i < NBENCHMARKS; i++)
+	if (selected(names, benchmarks[i].name))
+	    nselected++;
+    if (nselected == 0) {
+	fprintf(stderr, "Error: no benchmark selected by %s\n", names);
+	return 1;
+    }
+
+    FILE *out = stdout;
+    if (outfile != NULL && (out = fopen(outfile, "w")) == NULL) {
+	fprintf(stderr, "Error: unable to open %s\n", outfile);
+	return 1;
+    }
+
+    init(keyfile);
+
+    BenchContext ctx;
+    ctx.pvdate = BENCH_PVDATE;
+    ctx.curve = bench_curve();
+    ctx.tree = AKATreeFit(ctx.curve, NULL);
+    if (ctx.tree == 0) {
+	fprintf(stderr, "Error: tree fit failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    ctx.zerotree = AKATreeFitZero(ctx.curve);
+    ctx.krsetup = AKAKeyDurSetup(ctx.curve, NULL, 25, NULL, 0);
+    ctx.scen = AKAScenSetupAlloc(2);
+    ctx.scen->type = AKA_SCEN_NOW;
+    ctx.scen->dates[0] = ctx.pvdate;
+    ctx.scen->dates[1] = ctx.pvdate + 10000L;
+    ctx.scen->trees[0] = ctx.tree;
+    ctx.scen->trees[1] = AKATreeFitShift(ctx.tree, 100, AKA_SHIFT_PAR);
+    if (ctx.zerotree == 0 || ctx.krsetup == NULL ||
+	ctx.scen->trees[1] == 0) {
+	fprintf(stderr, "Error: benchmark setup failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+
+	/* the quotes for the price based benchmarks, not timed */
+    std::vector<BenchBond> bonds;
+    if (bench_portfolio(count, bonds) == 0) {
+	fprintf(stderr, "Error: benchmark portfolio failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    for (size_t i = 0; i < bonds.size(); i++) {
+	bonds[i].price = AKABondPrice(ctx.pvdate, ctx.tree, bonds[i].bond,
+				      bonds[i].oas);
+	if (!no_error() || bonds[i].price <= 0) {
+	    fprintf(stderr, "Warning: %s does not price, quoted at par\n",
+		    bonds[i].bond->sec->name);
+	    bonds[i].price = 100;
+	}
+    }
+
+    fprintf(out, "benchmark,kind,portfolio,count,threads,library,"
+	    "hwthreads,reps,errors,best_seconds,median_seconds,"
+	    "calls_per_second,checksum\n");
+    for (int bi = 0; bi < NBENCHMARKS; bi++) {
+	const Benchmark &bench = benchmarks[bi];
+	if (!selected(names, bench.name))
+	    continue;
+	for (int kind = bench.kinds == 0 ? -1 : 0; kind < BENCH_KINDS;
+	     kind++) {
+	    std::vector<const BenchBond *> items;
+	    if (kind < 0)
+		items.assign(nfits, (const BenchBond *) NULL);
+	    else if (bench.kinds & (1 << kind)) {
+		for (size_t i = 0; i < bonds.size(); i++)
+		    if (bonds[i].kind == kind)
+			items.push_back(&bonds[i]);
+	    }
+	    if (items.empty())
+		continue;
+	    for (size_t ti = 0; ti < threadcounts.size(); ti++) {
+		std::vector<double> secs, results;
+		long errors = 0;
+		for (int r = 0; r < reps; r++)
+		    secs.push_back(bench_run(&ctx, bench.op, items,
+					     threadcounts[ti], results,
+					     &errors));
+		std::sort(secs.begin(), secs.end());
+		double checksum = 0;
+		for (size_t i = 0; i < results.size(); i++)
+		    checksum += results[i];
+		double median = secs[secs.size() / 2];
+		fprintf(out, "%s,%s,%d,%d,%d,%.2f,%d,%d,%ld,%.6f,%.6f,%.1f,"
+			"%.10g\n", bench.name,
+			kind < 0 ? "curve" : bench_kind_name(kind),
+			BENCH_PORTFOLIO_VERSION, (int) items.size(),
+			threadcounts[ti], AKA_version(), hwthreads, reps,
+			errors, secs[0], median,
+			median > 0 ? items.size() / median : 0, checksum);
+		fflush(out);
+	    }
+	    if (kind < 0)
+		break;
+	}
+    }
+
+    if (out != stdout)
+	fclose(out);
+    bench_portfolio_free(bonds);
+    AKATreeRelease(ctx.scen->trees[1]);
+    AKAScenSetupFree(ctx.scen);
+    AKAKeyDurSetupFree(ctx.krsetup);
+    AKATreeRelease(ctx.zerotree);
+    AKATreeRelease(ctx.tree);
+    AKACurveFree(ctx.curve);
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: benchmark the library over synthetic portfolios\n");
+    printf("Usage: [FLAGS]\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-b <name,...> -- benchmarks to run, default all\n"
+	"\t-f <cnt> -- tree fits timed by treefit, default 20\n"
+	"\t-j <cnt,...> -- thread counts, default 1 and one per core\n");
+    printf(
+	"\t-n <cnt> -- bonds of each kind, default 100\n"
+	"\t-o <file> -- write the results to file, default stdout\n"
+	"\t-r <cnt> -- repetitions of each run, default 3\n");
+    printf("\nBenchmarks:");
+    for (int i = 0; i < NBENCHMARKS; i++)
+	printf(" %s", benchmarks[i].name);
+    printf("\nKinds:");
+    for (int i = 0; i < BENCH_KINDS; i++)
+	printf(" %s", bench_kind_name(i));
+    printf("\nPortfolio version: %d\n", BENCH_PORTFOLIO_VERSION);
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
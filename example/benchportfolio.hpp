@@ -0,0 +1,236 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Synthetic portfolios for benchmarking.  The bonds are generated from
+   a fixed seed with a generator of our own, so a portfolio is the same
+   on every platform and with every library release.  Results can then
+   be compared across releases.
+
+   BENCH_PORTFOLIO_VERSION names the portfolios.  Any change to what is
+   generated, even a coupon rounding, must bump it, so that results of
+   different portfolios are never compared.
+   ------------------------------------------------------------------------- */
+#ifndef _BENCHPORTFOLIO_HPP_
+#define _BENCHPORTFOLIO_HPP_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "akaapi.h"
+
+#define BENCH_PORTFOLIO_VERSION 1
+#define BENCH_PVDATE 20140115L
+
+enum BenchKind {
+    BENCH_BULLET,		/* optionless */
+    BENCH_CALLABLE,		/* American call at a declining premium */
+    BENCH_SINKER,		/* annual sinking fund, callable */
+    BENCH_STEPUP,		/* step up coupons, callable on the steps */
+    BENCH_MORTGAGE,		/* level pay, monthly, refinanceable */
+    BENCH_MUNI,			/* tax-exempt, discount issue, 10 year call */
+    BENCH_KINDS
+};
+
+inline const char *
+bench_kind_name(int kind)
+{
+    static const char *names[BENCH_KINDS] = {
+	"bullet", "callable", "sinker", "stepup", "mortgage", "muni"
+    };
+    return (kind >= 0 && kind < BENCH_KINDS) ? names[kind] : "unknown";
+}
+
+/* one bond of a portfolio, with the quote the benchmarks start from */
+struct BenchBond {
+    AKABOND *bond;
+    int kind;
+    double oas;			/* generated spread, bp */
+    double price;		/* clean price at oas, set by the caller */
+};
+
+/* -----------------------------------------------------------------
+   Linear congruential generator (Numerical Recipes constants).  Not
+   for simulation, only to make the same portfolio everywhere.
+   ----------------------------------------------------------------- */
+class BenchRandom {
+private:
+    uint32_t state;
+public:
+    BenchRandom(uint32_t seed) : state(seed) {};
+
+    uint32_t Next() { return state = state * 1664525u + 1013904223u; };
+	// integer in [lo, hi]
+    int Int(int lo, int hi) {
+	return lo + (int) ((Next() >> 8) % (uint32_t) (hi - lo + 1));
+    };
+	// multiple of step in [lo, hi]
+    double Step(double lo, double hi, double step) {
+	return lo + step * Int(0, (int) ((hi - lo) / step + .5));
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: generate bond i of a kind.  Dates are built as yyyymmdd
+	    with days of 15 or less so that adding years is safe.
+   Returns: allocated bond, NULL if the library could not build it
+   ----------------------------------------------------------------- */
+inline AKABOND *
+bench_bond(int kind, int i, BenchRandom &rnd)
+{
+    long idate = (BENCH_PVDATE / 10000 - rnd.Int(0, 6)) * 10000L +
+	rnd.Int(1, 12) * 100L + 15;
+    int term = rnd.Int(kind == BENCH_MORTGAGE ? 15 :
+		       kind == BENCH_STEPUP ? 6 : 3, 30);
+    long mdate = idate + term * 10000L;
+    double coupon = rnd.Step(2, 7, .125);
+    int ncalls = 0, nsinks = 0, ncpns = 0;
+    int firstcall = (kind == BENCH_MUNI) ? 10 : rnd.Int(2, 10);
+
+    if (mdate <= BENCH_PVDATE + 10000L)	/* at least a year to run */
+	mdate = idate + ((BENCH_PVDATE - idate) / 10000L + 2) * 10000L;
+    term = (int) ((mdate - idate) / 10000L);
+    if (firstcall >= term)
+	firstcall = term - 1;
+    switch (kind) {
+	case BENCH_CALLABLE :
+	case BENCH_MUNI :
+	    ncalls = term - firstcall;
+	    break;
+	case BENCH_SINKER :
+	    ncalls = term - firstcall;
+	    nsinks = term / 2;
+	    break;
+	case BENCH_STEPUP :
+	    ncpns = 3;
+	    ncalls = 3;
+	    break;
+    }
+
+    AKABOND *bond = AKABondAlloc(ncpns, ncalls, 0, nsinks);
+    AKASECURITY *sec = bond->sec;
+    sprintf(sec->name, "%s-%04d", bench_kind_name(kind), i);
+    sec->idate = idate;
+    sec->ddate = idate;
+    sec->mdate = mdate;
+    sec->coupon = coupon;
+    sec->daycount = AKA_DAYS_30_360;
+    sec->frequency = AKA_FREQ_SEMIANNUAL;
+    sec->yld_method = AKA_YLD_BEY;
+    sec->redemption_value = 100;
+    sec->issue_price = 100;
+
+    if (kind == BENCH_STEPUP) {
+	int step = term / 3;
+	bond->cpn->type = AKA_PERIOD_BEGIN;
+	for (int k = 0; k < 3; k++) {
+	    bond->cpn->date[k] = idate + k * step * 10000L;
+	    bond->cpn->cpn[k] = coupon + k;
+		/* callable at par on each step after the first */
+	    bond->call->date[k] = idate + (k + 1) * step * 10000L;
+	    bond->call->px[k] = 100;
+	}
+	if (bond->call->date[2] >= mdate)
+	    bond->call->date[2] = mdate - 10000L;
+	bond->call->type = AKA_OPTION_EUROPEAN;
+	bond->call->delay = 30;
+    }
+    else if (ncalls > 0) {
+	double premium = (kind == BENCH_MUNI) ? 0 : coupon / 2;
+	bond->call->type = AKA_OPTION_AMERICAN;
+	bond->call->delay = 30;
+	for (int k = 0; k < ncalls; k++) {
+	    bond->call->date[k] = idate + (firstcall + k) * 10000L;
+	    bond->call->px[k] = 100 + premium * (ncalls - k - 1) /
+		(ncalls > 1 ? ncalls - 1 : 1);
+	}
+    }
+
+    if (nsinks > 0) {
+	double size = 1000000. * rnd.Int(1, 50);
+	AKASINK *sink = bond->sink;
+	sink->face = size;
+	sink->acceleration = 100;
+	sink->delivery = 1;
+	sink->allocation = AKA_ALLOC_PRORATA;
+	for (int k = 0; k < nsinks; k++) {
+	    sink->date[k] = mdate - (nsinks - k) * 10000L;
+	    sink->amt[k] = size / (nsinks + 1);
+	    sink->px[k] = 100;
+	}
+    }
+
+    if (kind == BENCH_MORTGAGE) {
+	sec->frequency = AKA_FREQ_MONTHLY;
+	if (AKABondMortgage(bond, 100000. * rnd.Int(1, 10), term, 1.0) !=
+	    AKA_ERROR_NONE)
+	    return AKABondFree(bond);
+    }
+    else if (kind == BENCH_MUNI) {
+	sec->yld_method = AKA_YLD_MUNI;
+	sec->issue_price = rnd.Step(95, 100, .25);
+    }
+    return bond;
+}
+
+inline void
+bench_portfolio_free(std::vector<BenchBond> &bonds)
+{
+    for (size_t i = 0; i < bonds.size(); i++)
+	AKABondFree(bonds[i].bond);
+    bonds.clear();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: generate count bonds of each kind, in kind order.  The
+	    oas is generated here; the price is left for the caller,
+	    which has the tree.
+   Returns: number of bonds, 0 with none kept if a bond could not be
+	    built
+   ----------------------------------------------------------------- */
+inline size_t
+bench_portfolio(int count, std::vector<BenchBond> &bonds)
+{
+    for (int kind = 0; kind < BENCH_KINDS; kind++) {
+	BenchRandom rnd(BENCH_PORTFOLIO_VERSION * 7919u + kind);
+	for (int i = 0; i < count; i++) {
+	    BenchBond b;
+	    b.kind = kind;
+	    if ((b.bond = bench_bond(kind, i, rnd)) == NULL) {
+		bench_portfolio_free(bonds);
+		return 0;
+	    }
+	    b.oas = rnd.Step(0, 150, 5);
+	    b.price = 0;
+	    bonds.push_back(b);
+	}
+    }
+    return bonds.size();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the par curve the benchmarks fit
+   Returns: allocated curve
+   ----------------------------------------------------------------- */
+inline AKACURVE *
+bench_curve()
+{
+    static const double terms[] = {.25, .5, 1, 2, 3, 5, 7, 10, 20, 30};
+    static const double rates[] = {.10, .15, .25, .60, 1.00, 1.70, 2.25,
+				   2.80, 3.40, 3.70};
+    long n = (long) (sizeof(terms) / sizeof(terms[0]));
+    AKACURVE *curve = AKACurveAlloc(n);
+    curve->mode = AKA_VOLMODE_MEANREV;
+    curve->type = AKA_CURVE_PAR;
+    curve->vol = 15;
+    curve->alpha = 0;
+    for (long i = 0; i < n; i++) {
+	curve->time[i] = terms[i];
+	curve->yield[i] = rates[i];
+    }
+    return curve;
+}
+
+#endif // ifndef _BENCHPORTFOLIO_HPP_
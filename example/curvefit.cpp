@@ -0,0 +1,313 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Tree fits of a stream of curve ticks by TreeFitter (see
+   treefitter.hpp), against a fit from scratch for every tick.
+
+   The ticks start from the benchmark curve, or the curve of an AKACalc
+   yield file for a pvdate.  Each tick leaves the curve unchanged,
+   moves it in parallel by up to a quarter of a basis point, or twists
+   it, in the proportions of -u and -p.  A benchmark bond is priced off
+   each tick's tree both ways, and the program reports the fits of
+   each, their times, and the largest price difference.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "benchportfolio.hpp"
+#include "treefitter.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+/* -----------------------------------------------------------------
+   Purpose: a uniform number in [0, 1) from the seed, which is updated
+   Returns: the number
+   ----------------------------------------------------------------- */
+static double
+tick_uniform(unsigned long long *seed)
+{
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return (double) (*seed >> 11) / 9007199254740992.;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    long nticks = 1000;
+    double unchanged = .5;
+    double parallel = .4;
+    bool shiftfits = false;
+    unsigned long long seed = 1;
+
+    while((c = getopt(argc, argv, "a:n:p:Ss:u:"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'n' :
+		nticks = atol(optarg);
+		break;
+	    case 'p' :
+		parallel = atof(optarg);
+		break;
+	    case 'S' :
+		shiftfits = true;
+		break;
+	    case 's' :
+		seed = strtoull(optarg, NULL, 10);
+		break;
+	    case 'u' :
+		unchanged = atof(optarg);
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if ((argc != 0 && argc != 2) || nticks < 1 || unchanged < 0 ||
+	parallel < 0 || unchanged + parallel > 1) {
+	usage();
+	return 1;
+    }
+
+    init(keyfile);
+
+    long pvdate = BENCH_PVDATE;
+    AKACURVE *curve;
+    if (argc == 2) {
+	std::string error;
+	pvdate = akadatecnv(argv[0]);
+	curve = read_yield_curve(argv[1], pvdate, error);
+	if (curve == NULL) {
+	    fprintf(stderr, "Error: %s\n", error.c_str());
+	    return 1;
+	}
+    }
+    else
+	curve = bench_curve();
+
+    std::vector<BenchBond> bonds;
+    if (bench_portfolio(1, bonds) == 0) {
+	fprintf(stderr, "Error: benchmark portfolio failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    BenchBond &bench = bonds[BENCH_CALLABLE];
+
+    TreeFitter fitter;
+    fitter.SetShiftFits(shiftfits);
+    long coldfits = 0;
+    double coldsecs = 0, maxdiff = 0;
+    for (long k = 0; k < nticks; k++) {
+	double u = tick_uniform(&seed);
+	if (k > 0 && u >= unchanged) {
+	    double move = (tick_uniform(&seed) - .5) / 200;
+	    for (long i = 0; i < curve->n; i++) {
+		double w = (u < unchanged + parallel) ? 1 :
+		    2 * curve->time[i] / curve->time[curve->n - 1] - 1;
+		curve->yield[i] += (curve->type == AKA_CURVE_FACTOR) ?
+		    -w * move / 100 * curve->time[i] * curve->yield[i] :
+		    w * move;
+	    }
+	}
+
+	std::chrono::steady_clock::time_point start =
+	    std::chrono::steady_clock::now();
+	AKAHTREE cold = AKATreeFit(curve, NULL);
+	std::chrono::duration<double> elapsed =
+	    std::chrono::steady_clock::now() - start;
+	coldsecs += elapsed.count();
+	coldfits++;
+	AKAHTREE warm = fitter.Fit(curve);
+	if (cold == 0 || warm == 0) {
+	    fprintf(stderr, "Error: tree fit failed: %s\n",
+		    AKAErrorString(AKAError()));
+	    return 1;
+	}
+	double diff = AKABondPrice(pvdate, warm, bench.bond, bench.oas) -
+	    AKABondPrice(pvdate, cold, bench.bond, bench.oas);
+	if (fabs(diff) > maxdiff)
+	    maxdiff = fabs(diff);
+	AKATreeRelease(cold);
+    }
+
+    const TreeFitStats &stats = fitter.Stats();
+    printf("%ld ticks\n", nticks);
+    printf("from scratch: %ld fits, %.6f seconds\n", coldfits, coldsecs);
+    printf("TreeFitter:   %ld fits, %ld shift fits, %ld reused, "
+	   "%.6f seconds\n", stats.fits, stats.shifts, stats.reused,
+	   stats.seconds);
+    printf("largest price difference: %.8f\n", maxdiff);
+
+    fitter.Reset();		/* its tree, before AKA_shutdown() */
+    bench_portfolio_free(bonds);
+    AKACurveFree(curve);
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: tree fits of a stream of curve ticks by TreeFitter\n");
+    printf("Usage: [FLAGS] [<pvdate> <yield-file>]\n");
+    printf("Without a yield file the benchmark curve is used.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-n <cnt> -- number of ticks, default 1000\n"
+	"\t-p <fraction> -- ticks moving the curve in parallel, default .4\n"
+	"\t-S -- fit parallel moves from the last tree\n"
+	"\t-s <seed> -- seed of the ticks\n"
+	"\t-u <fraction> -- ticks leaving the curve unchanged, default .5\n");
+    printf("The other ticks twist the curve.\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
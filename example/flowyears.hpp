@@ -0,0 +1,264 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   The flows of a bond and their year fractions from a pvdate, computed
+   once and shared by every yield and duration taken from them.
+
+   A yield to a date discounts each flow by its year fraction from the
+   pvdate, by the bond's daycount.  Solving yields to many exercise
+   dates, and durations and convexities at each, would take the same
+   fractions again and again.  FlowYears::Prepare() reads the flows of
+   a bond once, with AKABondFlowOnly(), its accrued once, and the year
+   fractions of all its flow dates in one batch (see serialdate.hpp).
+   Preparing again for the same bond and pvdate keeps them.
+
+   flow_value() and flow_yield() then value the bond to any date, at a
+   bond equivalent yield compounded at the bond's frequency, from the
+   prepared fractions only.  To a date between flows the bond pays the
+   interest accrued to that date, taken pro rata from the next flow.
+   These are meant for bonds which redeem whole, with no sinking fund;
+   the yields of the library, with all its yield methods, remain those
+   of AKABondValueYields() and its kin.
+   ------------------------------------------------------------------------- */
+#ifndef _FLOWYEARS_HPP_
+#define _FLOWYEARS_HPP_
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "akaapi.h"
+#include "serialdate.hpp"
+
+#define FLOW_YIELD_ERROR -99999
+#define FLOW_YIELD_MAXSTEPS 50
+
+class FlowYears {
+private:
+    const AKABOND *bond;
+    char name[sizeof(AKASECURITY::name)];	/* the bond's, and its terms */
+    long idate, mdate;
+    double coupon;
+    long pvdate;
+    long daycount;
+    double accrued;
+    std::vector<long> dates;
+    std::vector<double> interest;
+    std::vector<double> principal;
+    std::vector<double> years;
+    long prepared, reused;
+
+	// the bond prepared is b, by its address, name and terms
+    bool Same(const AKABOND *b) const {
+	const AKASECURITY *sec = b->sec;
+	return bond == b && idate == sec->idate && mdate == sec->mdate &&
+	    coupon == sec->coupon &&
+	    strncmp(name, sec->name, sizeof(name)) == 0;
+    };
+public:
+    FlowYears()
+	: bond(NULL), idate(0), mdate(0), coupon(0), pvdate(0),
+	  daycount(0), accrued(0), prepared(0), reused(0) {
+	name[0] = '\0';
+    };
+
+	/* Read the flows of the bond at pvdate and their year fractions
+	   by daycount, zero for the bond's own.  Preparing the same
+	   bond again keeps them; the bond is known by its address with
+	   its name, dates and coupon, so a bond freed and another made
+	   at its address is read again.  A bond changed in place, or
+	   replaced by one of the same name and terms, must be Reset()
+	   first.  Returns false on a library error, see AKAError(). */
+    bool Prepare(long date, const AKABOND *b, long dc = 0) {
+	if (dc == 0)
+	    dc = b->sec->daycount;
+	if (Same(b) && pvdate == date && daycount == dc) {
+	    reused++;
+	    return true;
+	}
+	bond = NULL;
+	dates.clear();
+	interest.clear();
+	principal.clear();
+	if ((accrued = AKABondAccrued(date, b)) < 0)
+	    return false;
+	AKAFLOWREPORT *rpt = AKAFlowReportAlloc();
+	if (AKABondFlowOnly(date, b, rpt) != 0) {
+	    AKAFlowReportFree(rpt);
+	    return false;
+	}
+	dates.assign(rpt->date, rpt->date + rpt->nFlows);
+	interest.assign(rpt->iflow, rpt->iflow + rpt->nFlows);
+	principal.assign(rpt->pflow, rpt->pflow + rpt->nFlows);
+	AKAFlowReportFree(rpt);
+	years.resize(dates.size());
+	years_batch(date, dates.empty() ? NULL : &dates[0], dates.size(), dc,
+		    years.empty() ? NULL : &years[0]);
+	bond = b;
+	memcpy(name, b->sec->name, sizeof(name));
+	idate = b->sec->idate;
+	mdate = b->sec->mdate;
+	coupon = b->sec->coupon;
+	pvdate = date;
+	daycount = dc;
+	prepared++;
+	return true;
+    };
+
+	// forget the prepared bond, as when it is about to change
+    void Reset() { bond = NULL; };
+
+    const AKABOND *Bond() const { return bond; };
+    long Pvdate() const { return pvdate; };
+    long Daycount() const { return daycount; };
+    double Accrued() const { return accrued; };
+	// periods a year of the yield, semiannual for interest at maturity
+    long Frequency() const {
+	long f = bond->sec->frequency;
+	return f > 0 ? f : 2;
+    };
+
+    size_t Size() const { return dates.size(); };
+    long Date(size_t i) const { return dates[i]; };
+    double Years(size_t i) const { return years[i]; };
+    double Interest(size_t i) const { return interest[i]; };
+    double Principal(size_t i) const { return principal[i]; };
+    double Flow(size_t i) const { return interest[i] + principal[i]; };
+
+	// number of flows on or before date
+    size_t Through(long date) const {
+	return std::upper_bound(dates.begin(), dates.end(), date) -
+	    dates.begin();
+    };
+
+	// year fraction from the pvdate to date, a flow date or not
+    double YearsTo(long date) const {
+	size_t k = Through(date);
+	if (k > 0 && dates[k - 1] == date)
+	    return years[k - 1];
+	double t;
+	years_batch(pvdate, &date, 1, daycount, &t);
+	return t;
+    };
+
+	/* interest accrued at date since the last flow before it, with
+	   t its YearsTo() */
+    double AccruedAt(long date, double t) const {
+	size_t k = Through(date);
+	if (k > 0 && dates[k - 1] == date)
+	    return 0;
+	if (k == dates.size())
+	    return 0;
+	if (k == 0)
+	    return years[0] > 0 ?
+		accrued + (interest[0] - accrued) * t / years[0] : accrued;
+	double span = years[k] - years[k - 1];
+	return span > 0 ? interest[k] * (t - years[k - 1]) / span : 0;
+    };
+
+    long Prepared() const { return prepared; };
+    long Reused() const { return reused; };
+};
+
+/* the flows of a bond redeemed on a date, by its FlowYears */
+struct FlowRedemption {
+    long date;			/* the date redeemed */
+    double t;			/* its year fraction */
+    size_t through;		/* flows paid in full, through the date */
+    double payment;		/* paid on the date besides those flows */
+};
+
+/* -----------------------------------------------------------------
+   Purpose: the flows of a bond redeemed at price on date; a negative
+	    price takes the scheduled flows to maturity
+   Returns: the redemption
+   ----------------------------------------------------------------- */
+inline FlowRedemption
+flow_redemption(const FlowYears &fy, long date, double price)
+{
+    FlowRedemption r;
+    r.date = date;
+    if (price < 0) {
+	r.through = fy.Size();
+	r.t = r.through > 0 ? fy.Years(r.through - 1) : 0;
+	r.payment = 0;
+	return r;
+    }
+    r.t = fy.YearsTo(date);
+    r.through = fy.Through(date);
+    r.payment = price + fy.AccruedAt(date, r.t);
+    if (r.through > 0 && fy.Date(r.through - 1) == date)
+	r.payment -= fy.Principal(r.through - 1);	/* called instead */
+    return r;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the dirty value of a redemption at a yield, 7% as 7.0,
+	    and if wanted its modified duration and convexity
+   Returns: value per 100
+   ----------------------------------------------------------------- */
+inline double
+flow_value(const FlowYears &fy, const FlowRedemption &r, double yield,
+	   double *moddur = NULL, double *modcon = NULL)
+{
+    double f = (double) fy.Frequency();
+    double base = 1 + yield / (100 * f);
+    double value = 0, d1 = 0, d2 = 0;
+
+    for (size_t i = 0; i <= r.through; i++) {
+	double flow, n;
+	if (i < r.through) {
+	    flow = fy.Flow(i);
+	    n = f * fy.Years(i);
+	}
+	else {
+	    flow = r.payment;
+	    n = f * r.t;
+	}
+	if (flow == 0)
+	    continue;
+	double pv = flow * pow(base, -n);
+	value += pv;
+	d1 += pv * n;
+	d2 += pv * n * (n + 1);
+    }
+    if (moddur != NULL)
+	*moddur = value > 0 ? d1 / (f * base * value) : 0;
+    if (modcon != NULL)
+	*modcon = value > 0 ? d2 / (f * f * base * base * value) : 0;
+    return value;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the yield of a redemption at a clean price, by Newton
+	    steps from guess, 7% as 7.0
+   Returns: yield, FLOW_YIELD_ERROR if the steps do not settle
+   ----------------------------------------------------------------- */
+inline double
+flow_yield(const FlowYears &fy, const FlowRedemption &r, double price,
+	   double guess)
+{
+    double target = price + fy.Accrued();
+    double yield = guess;
+    double f = (double) fy.Frequency();
+
+    for (int step = 0; step < FLOW_YIELD_MAXSTEPS; step++) {
+	double moddur;
+	double value = flow_value(fy, r, yield, &moddur);
+	if (fabs(value - target) <= 1e-10 * target)
+	    return yield;
+	double slope = -moddur * value / 100;
+	if (!(slope < 0))
+	    break;
+	double next = yield - (value - target) / slope;
+	if (next <= -100 * f)	/* keep the base positive */
+	    next = (yield - 100 * f) / 2;
+	yield = next;
+    }
+    return FLOW_YIELD_ERROR;
+}
+
+#endif // ifndef _FLOWYEARS_HPP_
@@ -0,0 +1,84 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A bond frozen for reading by any number of threads.
+
+   A const AKABOND may be shared by threads, but the library derives
+   its schedule into the bond's private data (AKASECURITY _data) on
+   first use, so the first valuations of a shared bond on several
+   threads race to do the same work.  A C++ Bond shared through
+   Compatibility::CApiBond() is also invalidated by any Set{X}() on it.
+
+   FrozenBond::Freeze() copies a bond and makes the library derive its
+   data at once, on the calling thread, by AKABondAccrued() and
+   AKABondFlowOnly() at a valuation date.  The frozen copy is owned by
+   the FrozenBond, never changed after, and only handed out as const,
+   so it may be read from any thread with no lock; the bond it was made
+   from may be changed or freed.  FrozenBond::Compile() does the same
+   for a C++ Bond.  Both return a shared_ptr, which threads may hold
+   for as long as they use the bond.
+
+   Freezing does not validate more than the two calls do; a bond which
+   fails them is still frozen, with the error in Error().
+   ------------------------------------------------------------------------- */
+#ifndef _FROZENBOND_HPP_
+#define _FROZENBOND_HPP_
+
+#include <memory>
+
+#include "akaapi.h"
+#include "akaapi_compatibility.hpp"
+
+class FrozenBond {
+private:     // disallow copy, assignment
+    FrozenBond(const FrozenBond &);
+    FrozenBond & operator=(const FrozenBond &);
+
+    AKABOND *bond;
+    enum AKA_ERROR_NUMBER error;
+
+    FrozenBond(AKABOND *copy, long date) : bond(copy), error(AKA_ERROR_NONE) {
+	if (bond == NULL) {
+	    error = AKAError();
+	    return;
+	}
+	if (date == 0)
+	    date = bond->sec->idate != 0 ? bond->sec->idate : bond->sec->ddate;
+	AKAFLOWREPORT *rpt = AKAFlowReportAlloc();
+	if (AKABondAccrued(date, bond) < 0 ||
+	    AKABondFlowOnly(date, bond, rpt) != 0)
+	    error = AKAError();
+	AKAFlowReportFree(rpt);
+    };
+public:
+    ~FrozenBond() { AKABondFree(bond); };
+
+	/* Freeze a copy of the bond, derived at date, the pvdate it will
+	   be valued at, or zero for its issue date.  Returns NULL only
+	   if the bond could not be copied. */
+    static std::shared_ptr<const FrozenBond> Freeze(const AKABOND *bond,
+						    long date = 0) {
+	std::shared_ptr<const FrozenBond>
+	    frozen(new FrozenBond(AKABondCopy(bond), date));
+	if (frozen->bond == NULL)
+	    frozen.reset();
+	return frozen;
+    };
+
+	// Freeze() the C structure of a C++ Bond
+    static std::shared_ptr<const FrozenBond>
+    Compile(const AndrewKalotayAssociates::Bond &bond, long date = 0) {
+	return Freeze(AndrewKalotayAssociates::Compatibility::CApiBond(bond),
+		      date);
+    };
+
+	// the frozen bond, valid while the FrozenBond is held
+    const AKABOND *Bond() const { return bond; };
+    operator const AKABOND *() const { return bond; };
+
+	// the error of freezing, AKA_ERROR_NONE if the bond is sound
+    enum AKA_ERROR_NUMBER Error() const { return error; };
+};
+
+#endif // ifndef _FROZENBOND_HPP_
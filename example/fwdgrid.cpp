@@ -0,0 +1,358 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A grid of forward par curves computed by fwd_grid() (see
+   fwdgrid.hpp) and, for comparison, by AKAFwdRates().
+
+   The curve is the benchmark curve, or the curve of an AKACalc yield
+   file for a pvdate.  The times run from the step to the horizon.  The
+   program reports the time of each method over -r repetitions and the
+   largest difference between their grids; with -o it writes the grid.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "benchportfolio.hpp"
+#include "fwdgrid.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+/* -----------------------------------------------------------------
+   Purpose: parse a comma separated list of maturities, e.g., 2,5,10,30
+   Returns: number of maturities, 0 if any is bad
+   ----------------------------------------------------------------- */
+static size_t
+parse_maturities(const char *list, std::vector<double> &mats)
+{
+    mats.clear();
+    while (*list != '\0') {
+	char *end;
+	double mat = strtod(list, &end);
+	if (end == list || mat <= 0 || (*end != ',' && *end != '\0')) {
+	    mats.clear();
+	    break;
+	}
+	mats.push_back(mat);
+	list = (*end == ',') ? end + 1 : end;
+    }
+    return mats.size();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: seconds since start
+   Returns: elapsed seconds
+   ----------------------------------------------------------------- */
+static double
+seconds_since(std::chrono::steady_clock::time_point start)
+{
+    std::chrono::duration<double> elapsed =
+	std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    std::vector<double> mats;
+    int freq = 2;
+    int nthreads = (int) std::thread::hardware_concurrency();
+    double horizon = 10;
+    int stepmonths = 1;
+    int reps = 5;
+    bool output = false;
+
+    parse_maturities("1,2,3,5,7,10,20,30", mats);
+    while((c = getopt(argc, argv, "a:f:h:j:m:or:s:"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'f' :
+		freq = atoi(optarg);
+		break;
+	    case 'h' :
+		horizon = atof(optarg);
+		break;
+	    case 'j' :
+		nthreads = atoi(optarg);
+		break;
+	    case 'm' :
+		if (parse_maturities(optarg, mats) == 0) {
+		    fprintf(stderr, "Error: bad maturities %s\n", optarg);
+		    return 1;
+		}
+		break;
+	    case 'o' :
+		output = true;
+		break;
+	    case 'r' :
+		reps = atoi(optarg);
+		break;
+	    case 's' :
+		stepmonths = atoi(optarg);
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if ((argc != 0 && argc != 2) || freq < 1 || horizon <= 0 ||
+	stepmonths < 1) {
+	usage();
+	return 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+    if (reps < 1)
+	reps = 1;
+
+    init(keyfile);
+
+    AKACURVE *curve;
+    if (argc == 2) {
+	std::string error;
+	curve = read_yield_curve(argv[1], akadatecnv(argv[0]), error);
+	if (curve == NULL) {
+	    fprintf(stderr, "Error: %s\n", error.c_str());
+	    return 1;
+	}
+    }
+    else
+	curve = bench_curve();
+    AKAHTREE tree = AKATreeFit(curve, NULL);
+    AKACurveFree(curve);
+    if (tree == 0) {
+	fprintf(stderr, "Error: tree fit failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+
+    long ntimes = (long) floor(horizon * 12 / stepmonths + 1e-9);
+    AKAFWDREPORT *lib = AKAFwdReportAlloc(ntimes, (long) mats.size());
+    AKAFWDREPORT *grid = AKAFwdReportAlloc(ntimes, (long) mats.size());
+    for (long i = 0; i < ntimes; i++)
+	lib->times[i] = grid->times[i] = (i + 1) * stepmonths / 12.;
+    for (size_t m = 0; m < mats.size(); m++)
+	lib->mats[m] = grid->mats[m] = mats[m];
+
+    std::chrono::steady_clock::time_point start =
+	std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+	if (AKAFwdRates(tree, lib) != 0) {
+	    fprintf(stderr, "Error: AKAFwdRates failed: %s\n",
+		    AKAErrorString(AKAError()));
+	    return 1;
+	}
+    }
+    double libsecs = seconds_since(start) / reps;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < reps; r++) {
+	if (fwd_grid(tree, grid, freq, nthreads) != 0) {
+	    fprintf(stderr, "Error: tree gives no discount factors\n");
+	    return 1;
+	}
+    }
+    double gridsecs = seconds_since(start) / reps;
+
+    double maxdiff = 0;
+    for (long i = 0; i < ntimes; i++)
+	for (size_t m = 0; m < mats.size(); m++)
+	    maxdiff = std::max(maxdiff, fabs(grid->fwds[i][m] -
+					     lib->fwds[i][m]));
+
+    printf("%ld times by %d maturities, frequency %d\n", ntimes,
+	   (int) mats.size(), freq);
+    printf("AKAFwdRates: %.6f seconds\n", libsecs);
+    printf("fwd_grid:    %.6f seconds, %d threads\n", gridsecs, nthreads);
+    printf("largest difference: %.8f\n", maxdiff);
+    if (output) {
+	printf("\n%8s", "time");
+	for (size_t m = 0; m < mats.size(); m++)
+	    printf(" %8g", mats[m]);
+	printf("\n");
+	for (long i = 0; i < ntimes; i++) {
+	    printf("%8.4f", grid->times[i]);
+	    for (size_t m = 0; m < mats.size(); m++)
+		printf(" %8.4f", grid->fwds[i][m]);
+	    printf("\n");
+	}
+    }
+
+    AKAFwdReportFree(lib);
+    AKAFwdReportFree(grid);
+    AKATreeRelease(tree);
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: forward par curve grid by fwd_grid() and "
+	   "AKAFwdRates()\n");
+    printf("Usage: [FLAGS] [<pvdate> <yield-file>]\n");
+    printf("Without a yield file the benchmark curve is used.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-f <freq> -- coupons per year of the par rates, default 2\n"
+	"\t-h <years> -- last forward time, default 10\n"
+	"\t-j <cnt> -- number of threads, default one per core\n"
+	"\t-m <mat,...> -- maturities in years, default "
+	"1,2,3,5,7,10,20,30\n");
+    printf(
+	"\t-o -- write the grid\n"
+	"\t-r <cnt> -- repetitions timed, default 5\n"
+	"\t-s <months> -- step between forward times, default 1\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
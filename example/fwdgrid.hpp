@@ -0,0 +1,179 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A grid of forward par rates, nTimes by nMats, from discount factors
+   computed once.
+
+   The forward par rate of maturity M at time t, paying freq coupons a
+   year, is
+
+	freq * (D(t) - D(t + n / freq)) / sum(k = 1..n) D(t + k / freq)
+
+   with n = M * freq.  Every maturity at a time reads the same discount
+   factors D(t + k / freq), and times which differ by whole periods
+   read the same ones shifted.  fwd_grid() therefore asks the tree for
+   D() once per point of a grid of period steps, one grid per distinct
+   fraction of a period among the times, and takes each time's
+   maturities from one running sum of the annuity.  The work per time
+   is the longest maturity's number of periods, however many
+   maturities there are.  The times are split across threads.
+
+   A maturity of n whole periods and a fraction a of one more, such as
+   3 months or 1 year 3 months paying semiannually, has a short first
+   period of a, paying a / freq of a coupon:
+
+	freq * (D(t) - D(t + (a + n) / freq)) /
+	    (a * D(t + a / freq) + sum(k = 1..n) D(t + (a + k) / freq))
+
+   Its coupon dates are on the grid of the fraction of t + a, and the
+   maturities of one fraction share a running annuity.
+
+   The input and output are those of AKAFwdRates(), so a report can be
+   filled by either.
+   ------------------------------------------------------------------------- */
+#ifndef _FWDGRID_HPP_
+#define _FWDGRID_HPP_
+
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "akaapi.h"
+#include "workqueue.hpp"
+
+/* discount factors of one grid: df[k] = D((offset + k) / freq) */
+struct FwdDiscounts {
+    double offset;		/* fraction of a period, [0, 1) */
+    std::vector<double> df;
+};
+
+/* -----------------------------------------------------------------
+   Purpose: the grid of a fraction of a period, added if new, with at
+	    least need discount factors
+   Returns: index of the grid
+   ----------------------------------------------------------------- */
+inline long
+fwd_find_grid(std::vector<FwdDiscounts> &grids, double offset, long need)
+{
+    size_t k = 0;
+    while (k < grids.size() && fabs(grids[k].offset - offset) > 1e-9)
+	k++;
+    if (k == grids.size()) {
+	FwdDiscounts d;
+	d.offset = offset;
+	grids.push_back(d);
+    }
+    if ((long) grids[k].df.size() < need)
+	grids[k].df.resize(need);
+    return (long) k;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: fill rpt->fwds from the tree, like AKAFwdRates(), with
+	    freq coupons a year, on nthreads threads.  A maturity which
+	    is not a whole number of periods, such as 3 months, has a
+	    short first period of the fraction left over, paying that
+	    fraction of a coupon; under a period it is a single coupon
+	    at maturity.
+   Returns: 0 on success, else AKA_ERROR_CURVE for a maturity which
+	    is not positive, AKA_ERROR_HTREE if the tree gives no
+	    discount factors
+   ----------------------------------------------------------------- */
+inline long
+fwd_grid(AKAHTREE tree, AKAFWDREPORT *rpt, int freq, int nthreads)
+{
+    long nmats = rpt->nMats, ntimes = rpt->nTimes;
+    if (freq < 1)
+	freq = 2;
+
+	/* whole periods and first period fraction of each maturity;
+	   the maturities of each fraction by whole periods */
+    std::vector<long> whole(nmats), stubof(nmats), order(nmats);
+    std::vector<double> stubs;
+    std::vector<long> maxn;
+    for (long m = 0; m < nmats; m++) {
+	double n = rpt->mats[m] * freq;
+	if (!(n > 1e-9))
+	    return AKA_ERROR_CURVE;
+	whole[m] = (long) floor(n + 1e-9);
+	double a = n - whole[m];
+	if (a < 1e-9)
+	    a = 0;
+	size_t j = 0;
+	while (j < stubs.size() && fabs(stubs[j] - a) > 1e-9)
+	    j++;
+	if (j == stubs.size()) {
+	    stubs.push_back(a);
+	    maxn.push_back(0);
+	}
+	stubof[m] = (long) j;
+	maxn[j] = std::max(maxn[j], whole[m]);
+	order[m] = m;
+    }
+    std::sort(order.begin(), order.end(), [&](long a, long b) {
+	return stubof[a] != stubof[b] ? stubof[a] < stubof[b] :
+	    whole[a] < whole[b];
+    });
+
+	/* for each time its own point, and for each fraction the grid
+	   and index of its first coupon */
+    long nstubs = (long) stubs.size();
+    std::vector<FwdDiscounts> grids;
+    std::vector<long> gridof(ntimes * (nstubs + 1)), base(gridof.size());
+    for (long i = 0; i < ntimes; i++) {
+	for (long j = -1; j < nstubs; j++) {
+	    double g = rpt->times[i] * freq + (j < 0 ? 0 : stubs[j]);
+	    double b = floor(g + 1e-9);
+	    double offset = g - b;
+	    if (offset < 1e-9)
+		offset = 0;
+	    long k = i * (nstubs + 1) + j + 1;
+	    base[k] = (long) b;
+	    gridof[k] = fwd_find_grid(grids, offset,
+				      base[k] + (j < 0 ? 0 : maxn[j]) + 1);
+	}
+    }
+
+	/* the discount factors, split across threads by point */
+    std::vector<std::pair<size_t, long> > points;
+    for (size_t k = 0; k < grids.size(); k++)
+	for (long j = 0; j < (long) grids[k].df.size(); j++)
+	    points.push_back(std::make_pair(k, j));
+    std::atomic<bool> failed(false);
+    parallel_for((long) points.size(), nthreads, [&](long p, int) {
+	FwdDiscounts &d = grids[points[p].first];
+	long j = points[p].second;
+	d.df[j] = AKADiscount(tree, 0, 1, (d.offset + j) / freq);
+	if (!(d.df[j] > 0))
+	    failed = true;
+    });
+    if (failed)
+	return AKA_ERROR_HTREE;
+
+	/* the maturities of each fraction from one running annuity */
+    parallel_for(ntimes, nthreads, [&](long i, int) {
+	long first = i * (nstubs + 1);
+	double start = grids[gridof[first]].df[base[first]];
+	const double *df = NULL;
+	double annuity = 0;
+	long k = 0;
+	for (long j = 0; j < nmats; j++) {
+	    long m = order[j];
+	    if (j == 0 || stubof[m] != stubof[order[j - 1]]) {
+		long s = first + stubof[m] + 1;
+		df = &grids[gridof[s]].df[base[s]];
+		annuity = stubs[stubof[m]] * df[0];
+		k = 0;
+	    }
+	    for ( ; k < whole[m]; k++)
+		annuity += df[k + 1];
+	    rpt->fwds[i][m] = 100 * freq * (start - df[whole[m]]) / annuity;
+	}
+    });
+    return 0;
+}
+
+#endif // ifndef _FWDGRID_HPP_
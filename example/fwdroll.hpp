@@ -0,0 +1,161 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A solved InterestRateModel rolled forward to many horizons, for the
+   C++ API.
+
+   InterestRateModel(model, forward_period) projects the par curve of
+   one horizon; rolling a model to 120 monthly horizons that way
+   projects 120 times.  ForwardRoll::Roll() instead reads the forward
+   par curves of every horizon in one pass over the solved model's
+   tree, fwd_grid() of fwdgrid.hpp, at the maturities of the model's
+   curve.  The rolled curves keep the model's volatility settings.
+
+   A model curve's short terms, such as 0.25 years, are less than a
+   coupon period; fwd_grid() gives them a single short coupon rather
+   than rounding them to a period.
+
+   Horizons whose forward curve is within a tolerance, 0.01bp by
+   default, of the curve of an earlier horizon's solved model share
+   that model rather than solving a copy, so a flat stretch of curve
+   costs one solve.  Model() returns the shared model; Modify() first gives the
+   horizon a model of its own, a copy of a solved model being already
+   solved, and leaves the others as they were.  The distinct models
+   are solved on the given number of threads.
+   ------------------------------------------------------------------------- */
+#ifndef _FWDROLL_HPP_
+#define _FWDROLL_HPP_
+
+#include <math.h>
+
+#include <memory>
+#include <vector>
+
+#include "akaapi.hpp"
+#include "akaapi_compatibility.hpp"
+#include "fwdgrid.hpp"
+
+class ForwardRoll {
+private:     // disallow copy, assignment
+    ForwardRoll(const ForwardRoll &);
+    ForwardRoll & operator=(const ForwardRoll &);
+
+    std::vector<double> horizons;
+    std::vector<std::shared_ptr<AndrewKalotayAssociates::InterestRateModel> >
+	models;
+    size_t distinct;
+    int error;
+
+    void Release() {
+	horizons.clear();
+	models.clear();
+	distinct = 0;
+    };
+public:
+    ForwardRoll() : distinct(0), error(0) {};
+    ~ForwardRoll() {};
+
+	/* Roll the solved model to each of the years, ascending.  A
+	   horizon shares the model of the last horizon solved if no
+	   forward par rate differs from that horizon's by more than
+	   tolerance (7% as 7.0, so 1e-4 is 0.01bp); 0 shares only
+	   identical curves.  Returns Error(), like
+	   InterestRateModel::Solve(). */
+    int Roll(const AndrewKalotayAssociates::InterestRateModel &model,
+	     const std::vector<double> &years, int nthreads = 1,
+	     double tolerance = 1e-4) {
+	using namespace AndrewKalotayAssociates;
+	Release();
+	error = AKA_ERROR_NONE;
+	AKAHTREE tree = Compatibility::CApiTreeHandle(model);
+	if (tree == 0)
+	    return error = AKA_ERROR_HTREE;
+	if (years.empty())
+	    return error;
+	const AKACURVE *base = Compatibility::CApiCurve(model);
+
+	AKAFWDREPORT *rpt = AKAFwdReportAlloc((long) years.size(), base->n);
+	if (rpt == NULL)
+	    return error = AKA_ERROR_MEMORY;
+	for (size_t k = 0; k < years.size(); k++)
+	    rpt->times[k] = years[k];
+	for (long i = 0; i < base->n; i++)
+	    rpt->mats[i] = base->time[i];
+	if ((error = (int) fwd_grid(tree, rpt, 2, nthreads)) != 0) {
+	    AKAFwdReportFree(rpt);
+	    return error;
+	}
+
+	    /* the horizons starting a new model */
+	std::vector<size_t> firsts;
+	for (size_t k = 0; k < years.size(); k++) {
+	    bool same = (k > 0);
+	    for (long i = 0; same && i < base->n; i++) {
+		double diff = rpt->fwds[k][i] - rpt->fwds[firsts.back()][i];
+		same = fabs(diff) <= tolerance;
+	    }
+	    if (!same)
+		firsts.push_back(k);
+	}
+
+	    /* one solved model each, sharing the base's settings */
+	std::vector<std::shared_ptr<InterestRateModel> > solved(firsts.size());
+	std::vector<int> errors(firsts.size(), AKA_ERROR_NONE);
+	for (size_t d = 0; d < firsts.size(); d++) {
+	    AKACURVE *curve = AKACurveCopy(base);
+	    curve->type = AKA_CURVE_PAR;
+	    for (long i = 0; i < curve->n; i++)
+		curve->yield[i] = rpt->fwds[firsts[d]][i];
+	    solved[d] = std::make_shared<InterestRateModel>(
+		Compatibility::ModelFromCurve(curve));
+	    AKACurveFree(curve);
+	}
+	AKAFwdReportFree(rpt);
+	parallel_for((long) firsts.size(), nthreads, [&](long d, int) {
+	    errors[d] = solved[d]->Solve();
+	});
+	for (size_t d = 0; d < firsts.size(); d++) {
+	    if (errors[d] != AKA_ERROR_NONE) {
+		error = errors[d];
+		return error;
+	    }
+	}
+
+	horizons = years;
+	for (size_t k = 0, d = 0; k < years.size(); k++) {
+	    if (d + 1 < firsts.size() && firsts[d + 1] == k)
+		d++;
+	    models.push_back(solved[d]);
+	}
+	distinct = firsts.size();
+	return error;
+    };
+
+	// the error of the last Roll(), AKA_ERROR_NONE if it succeeded
+    int Error() const { return error; };
+    const char *ErrorString() const {
+	return AndrewKalotayAssociates::Status::ErrorString(error);
+    };
+
+	// valid after a successful Roll()
+    size_t Size() const { return models.size(); };
+    size_t Distinct() const { return distinct; };
+    double Horizon(size_t k) const { return horizons[k]; };
+    const AndrewKalotayAssociates::InterestRateModel &Model(size_t k) const {
+	return *models[k];
+    };
+
+	/* the model of horizon k alone, copied from the shared model
+	   if another horizon holds it */
+    AndrewKalotayAssociates::InterestRateModel &Modify(size_t k) {
+	if (models[k].use_count() > 1) {
+	    models[k] = std::make_shared<
+		AndrewKalotayAssociates::InterestRateModel>(*models[k]);
+	    distinct++;
+	}
+	return *models[k];
+    };
+};
+
+#endif // ifndef _FWDROLL_HPP_
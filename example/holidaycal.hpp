@@ -0,0 +1,186 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Holiday calendars shared by many bonds.
+
+   The library keeps the holidays of notification and ex-coupon periods
+   on each bond, set one date at a time by AKA_set_notifyholiday().  A
+   portfolio on one calendar repeats the same list on every bond.  A
+   HolidayCalendar is built once from the list, named, and reference
+   counted with shared_ptr, so the bonds and threads which use it all
+   share the one copy.
+
+   Over the years of its holidays, and a year either side, a calendar
+   holds a business day flag and rank per day, so IsBusinessDay() and
+   AddBusinessDays() are table lookups rather than scans of the list.
+   Outside those years only weekends are closed.  The tables are
+   indexed by serial day (see serialdate.hpp).  Apply() sets a bond to
+   the calendar with the holidays that can matter to it, those from a
+   date to its maturity, rather than the whole list.
+
+   A holiday file holds one date, yyyymmdd, per line, from 1900 on;
+   anything after a # is a comment.
+   ------------------------------------------------------------------------- */
+#ifndef _HOLIDAYCAL_HPP_
+#define _HOLIDAYCAL_HPP_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "akaapi.h"
+#include "serialdate.hpp"
+
+class HolidayCalendar {
+private:     // disallow copy, assignment
+    HolidayCalendar(const HolidayCalendar &);
+    HolidayCalendar & operator=(const HolidayCalendar &);
+
+    std::string name;
+    bool weekends;		/* weekends are closed */
+    std::vector<long> holidays;	/* sorted yyyymmdd */
+    long first;			/* serial day of the first table day */
+    std::vector<bool> open;	/* per day from first, a business day */
+    std::vector<long> rank;	/* business days before each day */
+    std::vector<long> serials;	/* serial days of the business days */
+
+	// a weekday, not in the table
+    bool Weekday(long serial) const {
+	long dow = serial % 7;	/* 0 is Sunday, 1/1/1900 was a Monday */
+	return !weekends || (dow != 0 && dow != 6);
+    };
+
+    bool InTable(long serial) const {
+	return serial >= first && serial - first < (long) open.size();
+    };
+public:
+	/* A calendar of n holidays, yyyymmdd in any order.  With
+	   weekends true Saturdays and Sundays are closed as well. */
+    HolidayCalendar(const std::string &name, const long *dates, size_t n,
+		    bool weekends = true)
+	: name(name), weekends(weekends), holidays(dates, dates + n),
+	  first(0) {
+	std::sort(holidays.begin(), holidays.end());
+	holidays.erase(std::unique(holidays.begin(), holidays.end()),
+		       holidays.end());
+	if (holidays.empty())
+	    return;
+	first = serial_day((holidays.front() / 10000 - 1) * 10000 + 101);
+	long last = serial_day((holidays.back() / 10000 + 1) * 10000 + 1231);
+	open.resize(last - first + 1);
+	rank.resize(open.size());
+	size_t h = 0;
+	for (long s = first; s <= last; s++) {
+	    long i = s - first;
+	    while (h < holidays.size() && serial_day(holidays[h]) < s)
+		h++;
+	    open[i] = Weekday(s) &&
+		!(h < holidays.size() && serial_day(holidays[h]) == s);
+	    rank[i] = (long) serials.size();
+	    if (open[i])
+		serials.push_back(s);
+	}
+    };
+
+	// true if date is a valid yyyymmdd, on or after 1/1/1900
+    static bool ValidDate(long date) {
+	long y = date / 10000, m = date / 100 % 100, d = date % 100;
+	return y >= 1900 && m >= 1 && m <= 12 && d >= 1 &&
+	    d <= serial_month_days(y, m);
+    };
+
+	/* Read a holiday file.  Returns NULL, with error set, if it
+	   cannot be read or holds a line which is not a date. */
+    static std::shared_ptr<HolidayCalendar>
+    Load(const std::string &name, const char *fname, std::string &error,
+	 bool weekends = true) {
+	FILE *fp = fopen(fname, "r");
+	if (fp == NULL) {
+	    error = std::string("unable to open holiday file ") + fname;
+	    return std::shared_ptr<HolidayCalendar>();
+	}
+	std::vector<long> dates;
+	char buf[256];
+	long lineno = 0;
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+	    lineno++;
+	    char *hash = strchr(buf, '#');
+	    if (hash != NULL)
+		*hash = '\0';
+	    if (strspn(buf, " \t\r\n") == strlen(buf))
+		continue;	/* blank or comment */
+	    char *end;
+	    long date = strtol(buf, &end, 10);
+	    bool number = (end != buf);
+	    while (*end == ' ' || *end == '\t' || *end == '\r' || *end == '\n')
+		end++;
+	    if (!number || *end != '\0' || !ValidDate(date)) {
+		char msg[80];
+		snprintf(msg, sizeof(msg), "bad date on line %ld of ", lineno);
+		error = msg + std::string(fname);
+		fclose(fp);
+		return std::shared_ptr<HolidayCalendar>();
+	    }
+	    dates.push_back(date);
+	}
+	fclose(fp);
+	return std::make_shared<HolidayCalendar>(name, dates.empty() ? NULL :
+						 &dates[0], dates.size(),
+						 weekends);
+    };
+
+    const std::string &Name() const { return name; };
+    const std::vector<long> &Holidays() const { return holidays; };
+    bool Weekends() const { return weekends; };
+
+	// true if date, yyyymmdd, is a business day
+    bool IsBusinessDay(long date) const {
+	long s = serial_day(date);
+	if (InTable(s))
+	    return open[s - first];
+	return Weekday(s) && !std::binary_search(holidays.begin(),
+						 holidays.end(), date);
+    };
+
+	/* the business day n business days after date, or before it if
+	   n is negative; with n zero, date if it is a business day,
+	   otherwise the next business day */
+    long AddBusinessDays(long date, long n) const {
+	long s = serial_day(date);
+	if (InTable(s)) {
+	    long r = rank[s - first] +
+		(n > 0 ? open[s - first] + n - 1 : n);
+	    if (r >= 0 && r < (long) serials.size())
+		return serial_date(serials[r]);
+	}
+	long step = n < 0 ? -1 : 1;
+	while (!IsBusinessDay(serial_date(s)) && n == 0)
+	    s++;
+	for (long k = 0; k != n; k += step) {
+	    do {
+		s += step;
+	    } while (!IsBusinessDay(serial_date(s)));
+	}
+	return serial_date(s);
+    };
+
+	/* Set the bond to this calendar: its weekends, and its holidays
+	   from date to the bond's maturity.  Any holidays set on the
+	   bond before are cleared. */
+    void Apply(AKABOND *bond, long date) const {
+	AKA_set_notifyweekends(bond, !weekends);
+	AKA_clear_notifyholidays(bond);
+	std::vector<long>::const_iterator it =
+	    std::lower_bound(holidays.begin(), holidays.end(), date);
+	for (; it != holidays.end() && *it <= bond->sec->mdate; ++it)
+	    AKA_set_notifyholiday(bond, *it);
+    };
+};
+
+#endif // ifndef _HOLIDAYCAL_HPP_
@@ -0,0 +1,458 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Key rate durations for the bonds of AKACalc data files, on several
+   threads.
+
+   Building the shifted trees for the key rates is the expensive part
+   of a key rate run, and it depends only on the curve.  AKAKeyDurSetup()
+   is called once per valuation thread for the yield file, and each
+   thread passes its own setup to AKABondKeyDur3(), which takes it
+   non-const, for all the bonds it values.  Calling AKABondKeyDur2()
+   per bond would rebuild them for every bond.
+
+   The bonds are read and written in order by the same pipeline as
+   streamvalue, run_pipeline() of workqueue.hpp; the valuation threads
+   take the next bond from a shared queue, so long and short bonds
+   balance across the threads by themselves.  The bond file may be
+   text or the binary form written by akacalc2bin.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "akacalc_binary.hpp"
+#include "workqueue.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+
+/* one bond record as it moves through the pipeline */
+struct KeyDurItem {
+    BondSpec spec;
+    PriceRecord price;
+    bool priced;
+    std::string line;		/* formatted output */
+};
+
+/* settings shared read-only by all stages */
+struct KeyDurSetup {
+    long pvdate;
+	/* one per valuation thread, each used by its thread alone */
+    std::vector<AKAKRDURSETUP *> krsetups;
+    bool have_prices;		/* a price file was given */
+    double oas;			/* quote when there is no price file */
+};
+
+/* -----------------------------------------------------------------
+   Purpose: key rate durations of one bond and its output line, with
+	    the key rate setup of valuation thread thread
+   Returns: nothing, item->line is set and the bond is freed
+   ----------------------------------------------------------------- */
+static void
+keydur_item(const KeyDurSetup *setup, int thread, KeyDurItem *item)
+{
+    char buf[400];
+    const char *key = item->spec.key.c_str();
+    AKABOND *bond = item->spec.bond;
+
+    if (bond == NULL)
+	item->line = key + std::string(" ERROR ") + item->spec.error + "\n";
+    else if (setup->have_prices && !item->priced)
+	item->line = key + std::string(" ERROR no price on pvdate\n");
+    else {
+	long pvdate = setup->pvdate;
+	long quotetype = AKA_QUOTE_OAS;
+	double quote = setup->oas;
+	if (item->priced) {
+	    quotetype = AKA_QUOTE_PRICE;
+	    quote = item->price.price;
+	    if (item->price.tradedate != 0)
+		pvdate = AKADatePack(pvdate, item->price.tradedate);
+	    if (item->price.outstanding >= 0 && bond->sink != NULL &&
+		bond->sink->n > 0)
+		bond->sink->outstanding = item->price.outstanding;
+	}
+	AKAKRDURREPORT *rpt = AKABondKeyDur3(pvdate, bond, quotetype, quote,
+					     setup->krsetups[thread]);
+	if (rpt == NULL)
+	    item->line = key + std::string(" ERROR ") +
+		AKAErrorString(AKAError()) + "\n";
+	else {
+	    snprintf(buf, sizeof(buf), " %.4f %.6f %.6f %.4f %.4f",
+		     rpt->oas, rpt->value, rpt->accrued, rpt->effDur,
+		     rpt->effCon);
+	    item->line = key + std::string(buf);
+	    for (long i = 0; i < rpt->n; i++) {
+		snprintf(buf, sizeof(buf), " %.4f", rpt->durs[i]);
+		item->line += buf;
+	    }
+	    item->line += "\n";
+	    AKAKRDurReportFree(rpt);
+	}
+    }
+    AKABondFree(bond);
+    item->spec.bond = NULL;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: parse a comma separated list of maturities, e.g., 2,5,10,30
+   Returns: number of maturities, 0 on a bad list
+   ----------------------------------------------------------------- */
+static size_t
+parse_maturities(const char *list, std::vector<double> &mats)
+{
+    mats.clear();
+    while (*list != '\0') {
+	char *end;
+	double mat = strtod(list, &end);
+	if (end == list || mat <= 0 || (*end != ',' && *end != '\0')) {
+	    mats.clear();
+	    break;
+	}
+	mats.push_back(mat);
+	list = (*end == ',') ? end + 1 : end;
+    }
+    return mats.size();
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *couponfile = NULL;
+    const char *pricefile = NULL;
+    std::vector<double> mats;
+    double durbp = 25;
+    int nthreads = (int) std::thread::hardware_concurrency();
+    int qsize = 256;
+    bool header = false;
+    bool timing = false;
+    bool quiet = false;
+    KeyDurSetup setup;
+    setup.oas = 0;
+    setup.have_prices = false;
+
+    while((c = getopt(argc, argv, "a:b:C:Hj:m:o:P:q:tz"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'b' :
+		durbp = atof(optarg);
+		break;
+	    case 'C' :
+		couponfile = optarg;
+		break;
+	    case 'H' :
+		header = true;
+		break;
+	    case 'j' :
+		nthreads = atoi(optarg);
+		break;
+	    case 'm' :
+		if (parse_maturities(optarg, mats) == 0) {
+		    fprintf(stderr, "Error: bad maturities %s\n", optarg);
+		    return 1;
+		}
+		break;
+	    case 'o' :
+		setup.oas = atof(optarg);
+		break;
+	    case 'P' :
+		pricefile = optarg;
+		break;
+	    case 'q' :
+		qsize = atoi(optarg);
+		break;
+	    case 't' :
+		timing = true;
+		break;
+	    case 'z' :
+		quiet = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 3) {
+	usage();
+	return 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+    if (qsize < 1)
+	qsize = 1;
+
+    setup.pvdate = akadatecnv(argv[0]);
+    const char *yieldfile = argv[1];
+    const char *bondfile = argv[2];
+    const char *callfile = argc > 3 ? argv[3] : NULL;
+    const char *putfile = argc > 4 ? argv[4] : NULL;
+    const char *sinkfile = argc > 5 ? argv[5] : NULL;
+
+    init(keyfile);
+
+    std::string error;
+    AKACURVE *curve = read_yield_curve(yieldfile, setup.pvdate, error);
+    if (curve == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    clock_t start = clock();
+    setup.krsetups.assign(nthreads, (AKAKRDURSETUP *) NULL);
+    for (int t = 0; t < nthreads; t++) {
+	setup.krsetups[t] = AKAKeyDurSetup(curve, NULL, durbp,
+					   mats.empty() ? NULL : &mats[0],
+					   (int) mats.size());
+	if (setup.krsetups[t] == NULL)
+	    break;
+    }
+    double setupsecs = INSECS(clock() - start);
+    if (mats.empty())
+	mats.assign(curve->time, curve->time + curve->n);
+    AKACurveFree(curve);
+    if (setup.krsetups.back() == NULL) {
+	fprintf(stderr, "Error: key rate setup failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+
+    BondSpecReader textspecs;
+    BinaryBondFile binspecs;
+    BondSource *specs = open_bond_source(bondfile, callfile, putfile,
+					 sinkfile, couponfile, textspecs,
+					 binspecs, error);
+    if (specs == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    PriceReader prices;
+    if (pricefile != NULL) {
+	if (!prices.Open(pricefile, setup.pvdate)) {
+	    fprintf(stderr, "Error: unable to open %s\n", pricefile);
+	    return 1;
+	}
+	setup.have_prices = true;
+    }
+
+    if (header && !quiet) {
+	printf("key oas value accrued effdur effcon");
+	for (size_t i = 0; i < mats.size(); i++)
+	    printf(" %g", mats[i]);
+	printf("\n");
+    }
+
+    start = clock();
+    time_t wallstart = time(NULL);
+
+    PriceReader *priced = setup.have_prices ? &prices : NULL;
+    long written = run_pipeline<KeyDurItem>(nthreads, qsize,
+	[&](KeyDurItem &item) {
+	    if (!specs->Next(item.spec))
+		return false;
+	    item.priced = priced != NULL &&
+		priced->Find(item.spec.key, item.price);
+	    return true;
+	},
+	[&](KeyDurItem &item, int t) { keydur_item(&setup, t, &item); },
+	[&](KeyDurItem &item) {
+	    if (!quiet)
+		fputs(item.line.c_str(), stdout);
+	});
+
+    if (specs->Orphans() > 0)
+	fprintf(stderr, "Warning: %ld option, sink, or coupon records "
+		"without a bond record\n", specs->Orphans());
+    if (timing)
+	fprintf(stderr, "%ld bonds, %d valuation threads, "
+		"setup cpu seconds = %0.2f, cpu seconds = %0.2f, "
+		"elapsed seconds = %ld\n",
+		written, nthreads, setupsecs, INSECS(clock() - start),
+		(long) (time(NULL) - wallstart));
+
+    for (int t = 0; t < nthreads; t++)
+	AKAKeyDurSetupFree(setup.krsetups[t]);
+    specs->Release();
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: key rate durations of the bonds of AKACalc data files\n");
+    printf("Usage: [FLAGS] <pvdate> <yield-file> <bond-file> "
+	   "[<call-file> [<put-file> [<sink-file>]]]\n");
+    printf("Use - in place of an unused call or put file name.\n");
+    printf("The bond file may be a binary file from akacalc2bin, "
+	   "without other files.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-b <bp> -- duration shift in basis points, default 25\n"
+	"\t-C <coupon-file> -- step up/down coupon file\n"
+	"\t-H -- write a header line with the key rate maturities\n"
+	"\t-j <cnt> -- number of valuation threads, default one per core\n");
+    printf(
+	"\t-m <mat,...> -- key rate maturities in years, default the "
+	"curve terms\n"
+	"\t-o <oas> -- value at oas when there is no price file, default 0\n"
+	"\t-P <price-file> -- value at the prices for the pvdate\n"
+	"\t-q <cnt> -- records queued between stages, default 256\n"
+	"\t-t -- display timings on stderr\n"
+	"\t-z -- silent mode, no output, for timing\n");
+    printf(
+	"\nOutput, one line per bond record, in input order:\n"
+	"\tkey oas value accrued effdur effcon keydur...\n"
+	"\tkey ERROR message\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
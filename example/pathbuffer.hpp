@@ -0,0 +1,387 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Interest rate paths in one flat buffer, for code which reads them
+   with vector loads.
+
+   A TREESAMPLE holds its paths as PATH_ITEM ***paths, one allocation
+   per maturity and path, with the rate and center of each item side
+   by side.  PathBuffer keeps all the rates in one array and all the
+   centers in another, each 64 byte aligned, in one of two orders:
+
+   PATH_MAJOR	the times of a path are contiguous: rate[m][p][t]
+   TIME_MAJOR	the paths at a time are contiguous: rate[m][t][p]
+
+   The inner dimension is padded to a multiple of 8 doubles, so every
+   row starts on a 64 byte boundary.  The buffer may be allocated here,
+   supplied by the caller (see Bytes()), or a file mapped into memory
+   which another process can Open() and read in place.  In every case
+   it starts with a PathsHeader and the maturities and times:
+
+	PathsHeader		magic, version, sizes, layout, offsets
+	mats, times		doubles
+	rate, center		the paths
+
+   path_buffer_from_sample() copies a TREESAMPLE filled by
+   AKA_treesample() into a buffer; the walks of pathengine.hpp are
+   generated into one directly, without the per path allocations.
+   ------------------------------------------------------------------------- */
+#ifndef _PATHBUFFER_HPP_
+#define _PATHBUFFER_HPP_
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX		/* keep std::min and std::max usable */
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "akaapi.h"
+
+#define PATHS_MAGIC		"AKAPATHS"
+#define PATHS_VERSION		1
+#define PATHS_BYTEORDER		0x01020304
+#define PATHS_ALIGN		64
+
+enum PathLayout { PATH_MAJOR, TIME_MAJOR };
+
+struct PathsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;
+    int32_t layout;
+    int32_t nmats, npaths, ntimes;
+    int32_t stride;		/* padded length of the inner dimension */
+    int32_t reserved;
+    int64_t first;		/* index of the first path */
+    uint64_t filesize;
+    uint64_t mats, times, rate, center;	/* offsets from the header */
+};
+
+class PathBuffer {
+private:     // disallow copy, assignment
+    PathBuffer(const PathBuffer &);
+    PathBuffer & operator=(const PathBuffer &);
+
+    enum Storage { NONE, OWNED, USER, MAPPED };
+    Storage storage;
+    char *raw;			/* OWNED: the allocation */
+    char *base;			/* the header, 64 byte aligned */
+    uint64_t capacity;
+    PathsHeader *hdr;
+    double *rate, *center;
+    int layout;
+#ifdef _WIN32
+    HANDLE file, mapping;
+#endif
+
+    static uint64_t Align(uint64_t n) {
+	return (n + PATHS_ALIGN - 1) / PATHS_ALIGN * PATHS_ALIGN;
+    };
+    static int Stride(int layout, int npaths, int ntimes) {
+	int n = (layout == TIME_MAJOR) ? npaths : ntimes;
+	return (n + 7) / 8 * 8;
+    };
+
+	// lay out the header and arrays at base, which holds capacity bytes
+    bool Place(int lay, long first, int nm, int np, int nt) {
+	uint64_t need = Bytes(lay, nm, np, nt);
+	if (need > capacity)
+	    return false;
+	int stride = Stride(lay, np, nt);
+	uint64_t cells = (uint64_t) nm * (lay == TIME_MAJOR ? nt : np) * stride;
+	hdr = (PathsHeader *) base;
+	memset(hdr, 0, sizeof(*hdr));
+	memcpy(hdr->magic, PATHS_MAGIC, sizeof(hdr->magic));
+	hdr->version = PATHS_VERSION;
+	hdr->byteorder = PATHS_BYTEORDER;
+	hdr->layout = lay;
+	hdr->nmats = nm;
+	hdr->npaths = np;
+	hdr->ntimes = nt;
+	hdr->stride = stride;
+	hdr->first = first;
+	hdr->filesize = need;
+	hdr->mats = Align(sizeof(PathsHeader));
+	hdr->times = hdr->mats + Align(nm * sizeof(double));
+	hdr->rate = hdr->times + Align(nt * sizeof(double));
+	hdr->center = hdr->rate + Align(cells * sizeof(double));
+	Arrays();
+	return true;
+    };
+
+	// point at the arrays of the header at base
+    void Arrays() {
+	layout = hdr->layout;
+	rate = (double *) (base + hdr->rate);
+	center = (double *) (base + hdr->center);
+    };
+
+	// header and array bounds of a buffer read from a file
+    std::string Check() const {
+	if (capacity < sizeof(PathsHeader) ||
+	    memcmp(hdr->magic, PATHS_MAGIC, sizeof(hdr->magic)) != 0)
+	    return "not a paths file";
+	if (hdr->version != PATHS_VERSION)
+	    return "unsupported paths file version";
+	if (hdr->byteorder != PATHS_BYTEORDER)
+	    return "paths file was written with another byte order";
+	if (hdr->layout != PATH_MAJOR && hdr->layout != TIME_MAJOR)
+	    return "unknown paths file layout";
+	if (hdr->nmats < 0 || hdr->npaths < 0 || hdr->ntimes < 0 ||
+	    hdr->stride != Stride(hdr->layout, hdr->npaths, hdr->ntimes) ||
+	    hdr->filesize != capacity ||
+	    Bytes(hdr->layout, hdr->nmats, hdr->npaths, hdr->ntimes) > capacity)
+	    return "paths file is truncated or inconsistent";
+	uint64_t cells = (uint64_t) hdr->nmats * hdr->stride *
+	    (hdr->layout == TIME_MAJOR ? hdr->ntimes : hdr->npaths);
+	uint64_t mats = Align(sizeof(PathsHeader));
+	uint64_t times = mats + Align(hdr->nmats * sizeof(double));
+	uint64_t rates = times + Align(hdr->ntimes * sizeof(double));
+	if (hdr->mats != mats || hdr->times != times || hdr->rate != rates ||
+	    hdr->center != rates + Align(cells * sizeof(double)))
+	    return "paths file offsets do not match its layout";
+	return "";
+    };
+public:
+    PathBuffer() : storage(NONE), raw(NULL), base(NULL), capacity(0),
+	hdr(NULL), rate(NULL), center(NULL), layout(PATH_MAJOR) {
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+    };
+    ~PathBuffer() { Close(); };
+
+	// bytes needed for a buffer of these sizes, header included
+    static uint64_t Bytes(int lay, int nm, int np, int nt) {
+	uint64_t cells = (uint64_t) nm * (lay == TIME_MAJOR ? nt : np) *
+	    Stride(lay, np, nt);
+	return Align(sizeof(PathsHeader)) + Align(nm * sizeof(double)) +
+	    Align(nt * sizeof(double)) + 2 * Align(cells * sizeof(double));
+    };
+
+	/* Size the buffer for nm maturities, np paths starting with path
+	   first, and nt times.  An allocated buffer grows as needed; a
+	   caller's buffer or a mapped file must already be large enough.
+	   The layout is kept from Allocate(), Attach(), or Map(), else
+	   PATH_MAJOR.  Returns false if the buffer is too small. */
+    bool Resize(long first, int nm, int np, int nt) {
+	if (storage == NONE || (storage == OWNED &&
+				Bytes(layout, nm, np, nt) > capacity))
+	    return Allocate(layout, first, nm, np, nt);
+	return Place(layout, first, nm, np, nt);
+    };
+
+	// allocate the buffer here
+    bool Allocate(int lay, long first, int nm, int np, int nt) {
+	Close();
+	uint64_t need = Bytes(lay, nm, np, nt);
+	raw = (char *) malloc((size_t) need + PATHS_ALIGN);
+	if (raw == NULL)
+	    return false;
+	base = raw + (PATHS_ALIGN - (uintptr_t) raw % PATHS_ALIGN) % PATHS_ALIGN;
+	capacity = need;
+	storage = OWNED;
+	return Place(lay, first, nm, np, nt);
+    };
+
+	/* use the caller's buffer of bytes, 64 byte aligned, at least
+	   Bytes() long, which must outlive this PathBuffer */
+    bool Attach(void *buf, uint64_t bytes, int lay, long first, int nm,
+		int np, int nt) {
+	Close();
+	if ((uintptr_t) buf % PATHS_ALIGN != 0)
+	    return false;
+	base = (char *) buf;
+	capacity = bytes;
+	storage = USER;
+	if (!Place(lay, first, nm, np, nt)) {
+	    Close();
+	    return false;
+	}
+	return true;
+    };
+
+	// create the file fname and map it, returns the error or ""
+    std::string Map(const char *fname, int lay, long first, int nm, int np,
+		    int nt) {
+	Close();
+	uint64_t need = Bytes(lay, nm, np, nt);
+#ifdef _WIN32
+	file = CreateFileA(fname, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+			   CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	    return std::string("unable to create ") + fname;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+				     (DWORD) (need >> 32), (DWORD) need, NULL);
+	if (mapping != NULL)
+	    base = (char *) MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+#else
+	int fd = open(fname, O_RDWR | O_CREAT | O_TRUNC, 0666);
+	if (fd < 0)
+	    return std::string("unable to create ") + fname;
+	if (ftruncate(fd, (off_t) need) != 0) {
+	    close(fd);
+	    return std::string("unable to size ") + fname;
+	}
+	void *p = mmap(NULL, (size_t) need, PROT_READ | PROT_WRITE,
+		       MAP_SHARED, fd, 0);
+	close(fd);
+	if (p != MAP_FAILED)
+	    base = (char *) p;
+#endif
+	storage = MAPPED;
+	capacity = need;
+	if (base == NULL) {
+	    Close();
+	    return std::string("unable to map ") + fname;
+	}
+	Place(lay, first, nm, np, nt);
+	return "";
+    };
+
+	// map a paths file written by Map() to read, returns the error or ""
+    std::string Open(const char *fname) {
+	Close();
+#ifdef _WIN32
+	file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL,
+			   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	    return std::string("unable to open ") + fname;
+	LARGE_INTEGER len;
+	if (!GetFileSizeEx(file, &len) || len.QuadPart == 0) {
+	    Close();
+	    return "not a paths file";
+	}
+	capacity = (uint64_t) len.QuadPart;
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping != NULL)
+	    base = (char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	int fd = open(fname, O_RDONLY);
+	if (fd < 0)
+	    return std::string("unable to open ") + fname;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+	    close(fd);
+	    return "not a paths file";
+	}
+	capacity = (uint64_t) st.st_size;
+	void *p = mmap(NULL, (size_t) capacity, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p != MAP_FAILED)
+	    base = (char *) p;
+#endif
+	storage = MAPPED;
+	if (base == NULL) {
+	    Close();
+	    return std::string("unable to map ") + fname;
+	}
+	hdr = (PathsHeader *) base;
+	std::string error = Check();
+	if (!error.empty())
+	    Close();
+	else
+	    Arrays();
+	return error;
+    };
+
+    void Close() {
+	if (storage == OWNED)
+	    free(raw);
+#ifdef _WIN32
+	if (storage == MAPPED && base != NULL)
+	    UnmapViewOfFile(base);
+	if (mapping != NULL)
+	    CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+	    CloseHandle(file);
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	if (storage == MAPPED && base != NULL)
+	    munmap(base, (size_t) capacity);
+#endif
+	storage = NONE;
+	raw = base = NULL;
+	capacity = 0;
+	hdr = NULL;
+	rate = center = NULL;
+    };
+
+	// select the layout of the next Resize() of an allocated buffer
+    void SetLayout(int lay) { layout = lay; };
+
+    int Layout() const { return layout; };
+    long First() const { return hdr ? (long) hdr->first : 0; };
+    int Mats() const { return hdr ? hdr->nmats : 0; };
+    int Paths() const { return hdr ? hdr->npaths : 0; };
+    int Times() const { return hdr ? hdr->ntimes : 0; };
+    int Stride() const { return hdr ? hdr->stride : 0; };
+    double *MatsArray() const { return (double *) (base + hdr->mats); };
+    double *TimesArray() const { return (double *) (base + hdr->times); };
+
+	// position of maturity m, path p, time t in RateArray()
+    size_t Index(int m, int p, int t) const {
+	if (layout == TIME_MAJOR)
+	    return ((size_t) m * hdr->ntimes + t) * hdr->stride + p;
+	return ((size_t) m * hdr->npaths + p) * hdr->stride + t;
+    };
+    double *RateArray() const { return rate; };
+    double *CenterArray() const { return center; };
+    double Rate(int m, int p, int t) const { return rate[Index(m, p, t)]; };
+    double Center(int m, int p, int t) const { return center[Index(m, p, t)]; };
+
+	/* an aligned row of Stride() doubles: the times of path i with
+	   PATH_MAJOR, the paths at time i with TIME_MAJOR */
+    double *RateRow(int m, int i) const {
+	return rate + ((size_t) m * (layout == TIME_MAJOR ? hdr->ntimes :
+				     hdr->npaths) + i) * hdr->stride;
+    };
+    double *CenterRow(int m, int i) const {
+	return center + ((size_t) m * (layout == TIME_MAJOR ? hdr->ntimes :
+				       hdr->npaths) + i) * hdr->stride;
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: copy a TREESAMPLE into a buffer, in the buffer's layout
+   Returns: false if the buffer is too small
+   ----------------------------------------------------------------- */
+inline bool
+path_buffer_from_sample(const struct TREESAMPLE *sample, PathBuffer &buf)
+{
+    if (!buf.Resize(0, sample->nmats, sample->npaths, sample->ntimes))
+	return false;
+    memcpy(buf.MatsArray(), sample->mats, sample->nmats * sizeof(double));
+    memcpy(buf.TimesArray(), sample->times, sample->ntimes * sizeof(double));
+    for (int m = 0; m < sample->nmats; m++) {
+	for (int p = 0; p < sample->npaths; p++) {
+	    const struct PATH_ITEM *items = sample->paths[m][p];
+	    for (int t = 0; t < sample->ntimes; t++) {
+		size_t k = buf.Index(m, p, t);
+		buf.RateArray()[k] = items[t].rate;
+		buf.CenterArray()[k] = items[t].center;
+	    }
+	}
+    }
+    return true;
+}
+
+#endif // ifndef _PATHBUFFER_HPP_
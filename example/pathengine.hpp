@@ -0,0 +1,603 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Path based (Monte Carlo) analysis of a bond on the random walks of
+   AKA_treesample(), for measures which depend on the path: the
+   distribution of the total return to a horizon, and the probability
+   of a call on each date.
+
+   Paths come from a PathSource a block at a time, in a PathBuffer (see
+   pathbuffer.hpp), so that a run never holds more than a block per
+   thread:
+
+   SamplePaths	the walks of a TREESAMPLE filled by AKA_treesample(),
+		as many as were sampled.
+
+   WalkPaths	walks generated here, as many as wanted.  A sample of
+		AKA_treesample() fixes the mean and spread of the log
+		rate of each maturity at each time; the walks are driven
+		by a single Brownian motion, as in a one factor model.
+		The normal draws come from a counter based generator,
+		a hash of the seed, the path, and the time, so path i is
+		the same whichever block or thread builds it.
+
+   With antithetic paths, each odd path mirrors the path before it in
+   log rate about the center of the rates.
+
+   path_analyze() runs the blocks on several threads.  The result of
+   each path is stored at its own index and the counts are integers,
+   so the result does not depend on the number of threads.
+
+   The bond is followed on a path by its flow dates and coupons, from
+   AKABondFlowOnly(), its calls, and maturity: cash received is
+   reinvested at the shortest maturity's rate, and on a call date the
+   issuer calls when the bond's value at the path rate of its remaining
+   term, plus the OAS, exceeds the call price.  Sinking funds, puts,
+   and amortization are not modeled.
+   ------------------------------------------------------------------------- */
+#ifndef _PATHENGINE_HPP_
+#define _PATHENGINE_HPP_
+
+#include <math.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "akaapi.h"
+#include "pathbuffer.hpp"
+#include "workqueue.hpp"
+
+#define PATH_SEED_DEFAULT 20140115u
+
+/* -----------------------------------------------------------------
+   Purpose: mix 64 bits (the splitmix64 finalizer)
+   Returns: mixed value
+   ----------------------------------------------------------------- */
+inline uint64_t
+path_mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the normal draw of a path at a time, counter based: the
+	    same arguments always give the same draw
+   Returns: standard normal deviate
+   ----------------------------------------------------------------- */
+inline double
+path_normal(uint64_t seed, long path, int step)
+{
+    uint64_t key = path_mix(seed + 0x9e3779b97f4a7c15ULL * (uint64_t) path);
+    uint64_t a = path_mix(key + 2 * (uint64_t) step);
+    uint64_t b = path_mix(key + 2 * (uint64_t) step + 1);
+    double u1 = ((a >> 11) + 1.0) / 9007199254740993.0;	/* (0, 1] */
+    double u2 = (b >> 11) / 9007199254740992.0;		/* [0, 1) */
+    return sqrt(-2 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+/* -----------------------------------------------------------------
+   Where paths come from.  Fill() and Write() may be called from
+   several threads at once, each with its own buffer or its own paths
+   of a shared one.
+   ----------------------------------------------------------------- */
+class PathSource {
+protected:
+    std::vector<double> mats;	/* maturities, ascending */
+    std::vector<double> times;	/* times from the pvdate, ascending */
+    bool antithetic;
+public:
+    PathSource() : antithetic(false) {};
+    virtual ~PathSource() {};
+
+    int Mats() const { return (int) mats.size(); };
+    int Times() const { return (int) times.size(); };
+    double Mat(int m) const { return mats[m]; };
+    double Time(int t) const { return times[t]; };
+
+	// make each odd path the mirror of the one before it
+    void SetAntithetic(bool on) { antithetic = on; };
+
+	// number of paths available, -1 for no limit
+    virtual long Paths() const = 0;
+
+	/* write the n paths starting at path first to the buffer, which
+	   is already sized, as its paths at to at + n - 1 */
+    virtual void Write(long first, int n, PathBuffer &buf, int at) const = 0;
+
+	/* fill the buffer with the n paths starting at path first, in
+	   its layout.  Returns false if the buffer is too small. */
+    bool Fill(long first, int n, PathBuffer &buf) const {
+	if (!buf.Resize(first, Mats(), n, Times()))
+	    return false;
+	Describe(buf);
+	Write(first, n, buf, 0);
+	return true;
+    };
+
+	// the maturities and times of a filled buffer
+    void Describe(PathBuffer &buf) const {
+	std::copy(mats.begin(), mats.end(), buf.MatsArray());
+	std::copy(times.begin(), times.end(), buf.TimesArray());
+    };
+};
+
+/* -----------------------------------------------------------------
+   The walks of a TREESAMPLE, which must outlive the SamplePaths.
+   With antithetic paths there are twice as many.
+   ----------------------------------------------------------------- */
+class SamplePaths : public PathSource {
+private:
+    const struct TREESAMPLE *sample;
+public:
+    SamplePaths(const struct TREESAMPLE *s) : sample(s) {
+	mats.assign(s->mats, s->mats + s->nmats);
+	times.assign(s->times, s->times + s->ntimes);
+    };
+
+    long Paths() const {
+	return antithetic ? 2L * sample->npaths : sample->npaths;
+    };
+
+    void Write(long first, int n, PathBuffer &buf, int at) const {
+	for (int m = 0; m < Mats(); m++) {
+	    for (int p = 0; p < n; p++) {
+		long path = first + p;
+		const struct PATH_ITEM *items =
+		    sample->paths[m][antithetic ? path / 2 : path];
+		bool mirror = antithetic && (path & 1);
+		for (int t = 0; t < Times(); t++) {
+		    size_t k = buf.Index(m, at + p, t);
+		    double c = items[t].center;
+		    buf.CenterArray()[k] = c;
+		    buf.RateArray()[k] = mirror ? c * c / items[t].rate :
+			items[t].rate;
+		}
+	    }
+	}
+    };
+};
+
+/* -----------------------------------------------------------------
+   Walks generated from the log rate mean and spread of a sample.
+   ----------------------------------------------------------------- */
+class WalkPaths : public PathSource {
+private:
+    uint64_t seed;
+	/* by maturity then time: mean and standard deviation of the
+	   log rate, and the mean center */
+    std::vector<double> level, scale, centers;
+public:
+    WalkPaths() : seed(PATH_SEED_DEFAULT) {};
+
+    void SetSeed(uint64_t s) { seed = s; };
+
+	/* Sample npaths walks of AKA_treesample() for the curve at the
+	   maturities and times, and keep their statistics.  Returns
+	   AKA_ERROR_NONE, AKA_ERROR_TREESAMPLE for fewer than one path,
+	   AKA_ERROR_MEMORY, or the library error of the sampling. */
+    enum AKA_ERROR_NUMBER Calibrate(AKACURVE *curve,
+				    const std::vector<double> &m,
+				    const std::vector<double> &t,
+				    int npaths) {
+	if (npaths < 1)
+	    return AKA_ERROR_TREESAMPLE;
+	mats = m;
+	times = t;
+	int nm = Mats(), nt = Times();
+	struct TREESAMPLE *sample = AKA_treesample_alloc(nm, npaths, nt);
+	if (sample == NULL)
+	    return AKA_ERROR_MEMORY;
+	std::copy(mats.begin(), mats.end(), sample->mats);
+	std::copy(times.begin(), times.end(), sample->times);
+	if (AKA_treesample(curve, sample) != 0) {
+	    AKA_treesample_free(sample);
+	    enum AKA_ERROR_NUMBER error = AKAError();
+	    return error != AKA_ERROR_NONE ? error : AKA_ERROR_TREESAMPLE;
+	}
+	level.assign((size_t) nm * nt, 0);
+	scale.assign((size_t) nm * nt, 0);
+	centers.assign((size_t) nm * nt, 0);
+	for (int i = 0; i < nm; i++) {
+	    for (int k = 0; k < nt; k++) {
+		double sum = 0, sumsq = 0, csum = 0;
+		for (int p = 0; p < npaths; p++) {
+		    double x = log(sample->paths[i][p][k].rate);
+		    sum += x;
+		    sumsq += x * x;
+		    csum += sample->paths[i][p][k].center;
+		}
+		double mean = sum / npaths;
+		double var = sumsq / npaths - mean * mean;
+		level[i * nt + k] = mean;
+		scale[i * nt + k] = var > 0 ? sqrt(var) : 0;
+		centers[i * nt + k] = csum / npaths;
+	    }
+	}
+	AKA_treesample_free(sample);
+	return AKA_ERROR_NONE;
+    };
+
+    long Paths() const { return -1; };
+
+    void Write(long first, int n, PathBuffer &buf, int at) const {
+	int nm = Mats(), nt = Times();
+	std::vector<double> u(nt);
+	double *rate = buf.RateArray(), *center = buf.CenterArray();
+	for (int p = 0; p < n; p++) {
+	    long path = first + p;
+	    long draw = antithetic ? path / 2 : path;
+	    double sign = (antithetic && (path & 1)) ? -1 : 1;
+		/* the standardized Brownian motion at each time */
+	    double w = 0, tprev = 0;
+	    for (int k = 0; k < nt; k++) {
+		double dt = times[k] - tprev;
+		if (dt > 0)
+		    w += sqrt(dt) * path_normal(seed, draw, k);
+		tprev = times[k];
+		u[k] = times[k] > 0 ? sign * w / sqrt(times[k]) : 0;
+	    }
+	    for (int i = 0; i < nm; i++) {
+		for (int k = 0; k < nt; k++) {
+		    size_t j = buf.Index(i, at + p, k);
+		    rate[j] = exp(level[i * nt + k] + scale[i * nt + k] * u[k]);
+		    center[j] = centers[i * nt + k];
+		}
+	    }
+	}
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: generate npaths paths of the source into one buffer, in
+	    blocks of blocksize paths on nthreads threads.  Each block
+	    is written in place, and a path is the same whichever thread
+	    writes it, so the buffer does not depend on the number of
+	    threads.  An allocated buffer is sized here, in its layout;
+	    a caller's buffer or mapped file must be large enough.
+   Returns: false if the source has too few paths or the buffer is
+	    too small
+   ----------------------------------------------------------------- */
+inline bool
+path_generate(const PathSource &src, long npaths, int blocksize,
+	      int nthreads, PathBuffer &buf)
+{
+    if (src.Paths() >= 0 && npaths > src.Paths())
+	return false;
+    if (!buf.Resize(0, src.Mats(), (int) npaths, src.Times()))
+	return false;
+    src.Describe(buf);
+    if (blocksize < 1)
+	blocksize = 1;
+
+    long nblocks = (npaths + blocksize - 1) / blocksize;
+    parallel_for(nblocks, nthreads, [&](long k, int) {
+	long first = k * blocksize;
+	int n = (int) std::min((long) blocksize, npaths - first);
+	src.Write(first, n, buf, (int) first);
+    });
+    return true;
+}
+
+/* one bond to follow along the paths */
+struct PathBond {
+    const AKABOND *bond;
+    long pvdate;
+    long horizon;
+    double price;		/* clean price at the pvdate */
+    double oas;			/* bp, added to the path rates */
+};
+
+/* the result of path_analyze() */
+struct PathResult {
+    long npaths;			/* paths analyzed */
+    long failed;			/* paths of blocks not filled */
+    std::vector<double> returns;	/* total return to the horizon, %,
+					   NAN for a failed path */
+    std::vector<long> calldates;	/* call dates to the horizon */
+    std::vector<long> calls;		/* paths called on each date */
+
+	// the mean return of the paths analyzed, summed in path order
+    double Mean() const {
+	double sum = 0;
+	long n = 0;
+	for (size_t i = 0; i < returns.size(); i++) {
+	    if (returns[i] == returns[i]) {
+		sum += returns[i];
+		n++;
+	    }
+	}
+	return n == 0 ? 0 : sum / n;
+    };
+
+	// the return at fraction q of the distribution, 0 <= q <= 1
+    double Percentile(double q) const {
+	std::vector<double> sorted;
+	for (size_t i = 0; i < returns.size(); i++)
+	    if (returns[i] == returns[i])
+		sorted.push_back(returns[i]);
+	if (sorted.empty())
+	    return 0;
+	size_t k = (size_t) (q * (sorted.size() - 1) + .5);
+	std::nth_element(sorted.begin(), sorted.begin() + k, sorted.end());
+	return sorted[k];
+    };
+};
+
+/* -----------------------------------------------------------------
+   The events of a bond between the pvdate and the horizon, with what
+   the path walk needs to know at each, computed once per bond.
+   ----------------------------------------------------------------- */
+struct PathEvent {
+    long date;
+    double t;			/* years from the pvdate */
+    int tindex;			/* path time in effect */
+    int mindex;			/* maturity nearest the remaining term */
+    double coupon;		/* paid on the date, % of face */
+    double callpx;		/* call price, < 0 if not callable */
+    double rate;		/* annual coupon rate in effect */
+    double a;			/* periods to the next coupon, (0, 1] */
+    int nafter;			/* coupons after the next one */
+    bool maturity;
+    bool horizon;
+};
+
+/* -----------------------------------------------------------------
+   Purpose: the coupon rate of the period ending on date
+   Returns: annual rate, %
+   ----------------------------------------------------------------- */
+inline double
+path_coupon_rate(const AKABOND *bond, long date)
+{
+    const AKACOUPON *cpn = bond->cpn;
+    double rate = bond->sec->coupon;
+    if (cpn == NULL)
+	return rate;
+    for (long i = 0; i < cpn->n; i++) {
+	if (cpn->type == AKA_PERIOD_BEGIN ? cpn->date[i] < date :
+	    (i == 0 || cpn->date[i - 1] < date))
+	    rate = cpn->cpn[i];
+    }
+    return rate;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the call price in effect on date
+   Returns: call price, < 0 if not callable on date
+   ----------------------------------------------------------------- */
+inline double
+path_call_price(const AKABOND *bond, long date)
+{
+    const AKAOPTION *call = bond->call;
+    double px = -1;
+    if (call == NULL)
+	return px;
+    for (long i = 0; i < call->n && call->date[i] <= date; i++) {
+	if (call->type == AKA_OPTION_AMERICAN || call->date[i] == date)
+	    px = call->px[i];
+    }
+    return px;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the events of a bond on the path times of a source, the
+	    coupon dates and amounts those of AKABondFlowOnly(), so odd
+	    coupons and the bond's payment days are kept
+   Returns: false with the library error set if the flows cannot be
+	    had, else the events in date order, the last at the horizon
+	    or maturity
+   ----------------------------------------------------------------- */
+inline bool
+path_schedule(const PathSource &src, const PathBond &b,
+	      std::vector<PathEvent> &events)
+{
+    const AKASECURITY *sec = b.bond->sec;
+    int freq = sec->frequency > 0 ? (int) sec->frequency : 1;
+    std::vector<long> cpndates, dates;
+    std::vector<double> cpnflows;
+
+    events.clear();
+    AKAFLOWREPORT *flows = AKAFlowReportAlloc();
+    if (AKABondFlowOnly(b.pvdate, b.bond, flows) != 0 ||
+	AKAError() != AKA_ERROR_NONE) {
+	AKAFlowReportFree(flows);
+	return false;
+    }
+    for (long i = 0; i < flows->nFlows; i++) {
+	if (flows->date[i] > b.pvdate &&
+	    (flows->iflow[i] != 0 || flows->date[i] == sec->mdate)) {
+	    cpndates.push_back(flows->date[i]);
+	    cpnflows.push_back(flows->iflow[i]);
+	}
+    }
+    AKAFlowReportFree(flows);
+    long end = std::min(b.horizon, sec->mdate);
+    for (size_t i = 0; i < cpndates.size() && cpndates[i] <= end; i++)
+	dates.push_back(cpndates[i]);
+    if (b.bond->call != NULL && b.bond->call->type != AKA_OPTION_AMERICAN) {
+	for (long i = 0; i < b.bond->call->n; i++) {
+	    long d = b.bond->call->date[i];
+	    if (d > b.pvdate && d < end)
+		dates.push_back(d);
+	}
+    }
+    if (end < sec->mdate)
+	dates.push_back(end);
+    std::sort(dates.begin(), dates.end());
+    dates.erase(std::unique(dates.begin(), dates.end()), dates.end());
+
+    for (size_t i = 0; i < dates.size(); i++) {
+	PathEvent e;
+	e.date = dates[i];
+	e.t = AKAYears(b.pvdate, e.date, AKA_DAYS_ACT_ACT);
+	e.tindex = 0;
+	while (e.tindex + 1 < src.Times() && src.Time(e.tindex + 1) <= e.t)
+	    e.tindex++;
+	double remaining = AKAYears(e.date, sec->mdate, AKA_DAYS_ACT_ACT);
+	e.mindex = 0;
+	for (int m = 1; m < src.Mats(); m++) {
+	    if (fabs(src.Mat(m) - remaining) < fabs(src.Mat(e.mindex) - remaining))
+		e.mindex = m;
+	}
+	size_t next = std::upper_bound(cpndates.begin(), cpndates.end(),
+				       e.date - 1) - cpndates.begin();
+	bool paydate = next < cpndates.size() && cpndates[next] == e.date;
+	e.rate = path_coupon_rate(b.bond, e.date);
+	e.coupon = paydate ? cpnflows[next] : 0;
+	e.maturity = e.date == sec->mdate;
+	e.horizon = e.date == b.horizon && !e.maturity;
+	e.callpx = e.maturity ? -1 : path_call_price(b.bond, e.date);
+	if (paydate)
+	    next++;		/* the coupon is paid, value from the next */
+	e.nafter = (int) cpndates.size() - (int) next - 1;
+	if (next >= cpndates.size())
+	    e.a = 1;
+	else {
+	    long prev = next > 0 ? cpndates[next - 1] :
+		AKADateAdd(cpndates[next], -1.0 / freq, AKA_DAYS_30_360);
+	    e.a = AKAYears(e.date, cpndates[next], AKA_DAYS_30_360) /
+		AKAYears(prev, cpndates[next], AKA_DAYS_30_360);
+	    if (e.a <= 0 || e.a > 1)
+		e.a = 1;
+	}
+	events.push_back(e);
+    }
+    return true;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: value of the remaining flows after an event at a yield
+   Returns: dirty price
+   ----------------------------------------------------------------- */
+inline double
+path_flow_value(const PathEvent &e, int freq, double yield)
+{
+    double c = e.rate / freq;
+    double i = yield / 100 / freq;
+    double v = 1 / (1 + i);
+    double vn = pow(v, e.nafter);
+    double annuity = fabs(i) < 1e-12 ? e.nafter : (1 - vn) / i;
+    return (c + c * annuity + 100 * vn) * pow(v, e.a);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: follow the bond along path p of a block
+   Returns: total return to the horizon in %, *called set to the
+	    index of the call event or -1
+   ----------------------------------------------------------------- */
+inline double
+path_walk(const PathBond &b, const std::vector<PathEvent> &events,
+	  double full, const PathBuffer &block, int p, int *called)
+{
+    int freq = b.bond->sec->frequency > 0 ? (int) b.bond->sec->frequency : 1;
+    double cash = 0, tlast = 0;
+    int tlastindex = 0;
+    double horizont = AKAYears(b.pvdate, b.horizon, AKA_DAYS_ACT_ACT);
+
+	/* path rates are in percent, semiannual as AKA_treesample()
+	   gives them, so cash grows by (1 + r / 200) per half year */
+    *called = -1;
+    for (size_t i = 0; i < events.size(); i++) {
+	const PathEvent &e = events[i];
+	double r = block.Rate(0, p, tlastindex);
+	cash *= pow(1 + r / 200, 2 * (e.t - tlast));
+	tlast = e.t;
+	tlastindex = e.tindex;
+	cash += e.coupon;
+	if (e.maturity) {
+	    cash += 100;
+	    break;
+	}
+	double yield = block.Rate(e.mindex, p, e.tindex) + b.oas / 100;
+	if (e.horizon) {
+	    cash += path_flow_value(e, freq, yield);
+	    break;
+	}
+	if (e.callpx >= 0) {
+	    double accrued = e.rate / freq * (1 - e.a);
+	    if (path_flow_value(e, freq, yield) - accrued > e.callpx) {
+		cash += e.callpx + accrued;
+		*called = (int) i;
+		break;
+	    }
+	}
+    }
+	/* reinvest to the horizon after a call or maturity */
+    if (tlast < horizont)
+	cash *= pow(1 + block.Rate(0, p, tlastindex) / 200,
+		    2 * (horizont - tlast));
+    return 100 * (cash / full - 1);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: analyze the bond on npaths paths of the source, in blocks
+	    of blocksize paths on nthreads threads
+   Returns: number of paths analyzed, fewer than npaths if the source
+	    ran out or a block could not be filled; -1 with the library
+	    error set if the bond's flows cannot be had
+   ----------------------------------------------------------------- */
+inline long
+path_analyze(const PathSource &src, const PathBond &b, long npaths,
+	     int blocksize, int nthreads, PathResult &res)
+{
+    std::vector<PathEvent> events;
+    res.npaths = res.failed = 0;
+    res.returns.clear();
+    res.calldates.clear();
+    res.calls.clear();
+    if (!path_schedule(src, b, events))
+	return -1;
+    double full = b.price + AKABondAccrued(b.pvdate, b.bond);
+
+    if (src.Paths() >= 0 && npaths > src.Paths())
+	npaths = src.Paths();
+    if (blocksize < 1)
+	blocksize = 1;
+    if (nthreads < 1)
+	nthreads = 1;
+    long nblocks = (npaths + blocksize - 1) / blocksize;
+    std::atomic<long> failed(0);
+    std::vector<std::vector<long> > counts(nthreads,
+					   std::vector<long>(events.size()));
+    std::vector<PathBuffer> blocks(nthreads);
+
+    res.returns.assign(npaths, NAN);
+    parallel_for(nblocks, nthreads, [&](long k, int t) {
+	PathBuffer &block = blocks[t];
+	long first = k * blocksize;
+	int n = (int) std::min((long) blocksize, npaths - first);
+	if (!src.Fill(first, n, block)) {
+	    failed += n;
+	    return;
+	}
+	for (int p = 0; p < n; p++) {
+	    int called;
+	    res.returns[first + p] = path_walk(b, events, full, block, p,
+						&called);
+	    if (called >= 0)
+		counts[t][called]++;
+	}
+    });
+    res.failed = failed;
+    res.npaths = npaths - res.failed;
+
+    for (size_t i = 0; i < events.size(); i++) {
+	if (events[i].callpx < 0)
+	    continue;
+	long n = 0;
+	for (int t = 0; t < nthreads; t++)
+	    n += counts[t][i];
+	res.calldates.push_back(events[i].date);
+	res.calls.push_back(n);
+    }
+    return res.npaths;
+}
+
+#endif // ifndef _PATHENGINE_HPP_
@@ -0,0 +1,373 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Path based analysis of a benchmark bond (see pathengine.hpp): the
+   distribution of its total return to a horizon and its probability
+   of being called by each call date.
+
+   By default the paths are generated in blocks from the statistics of
+   a small AKA_treesample() calibration sample, so any number of paths
+   may be run without holding them in memory.  With -S the paths are
+   those of one AKA_treesample() of the full size.
+
+   With -w the paths are also written to a file in the flat layout of
+   pathbuffer.hpp, which other programs can map and read in place.
+   They are generated in blocks on the -j threads, and the file is the
+   same for any number of threads.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "benchportfolio.hpp"
+#include "pathbuffer.hpp"
+#include "pathengine.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *pathfile = NULL;
+    bool antithetic = false;
+    bool whole = false;
+    int layout = PATH_MAJOR;
+    int blocksize = 1000;
+    int calibrate = 500;
+    double horizon_years = 1;
+    int index = 0;
+    int kind = BENCH_CALLABLE;
+    int nthreads = (int) std::thread::hardware_concurrency();
+    long npaths = 10000;
+    unsigned long seed = PATH_SEED_DEFAULT;
+
+    while((c = getopt(argc, argv, "a:Ab:c:h:i:j:k:n:Ss:Tw:"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'A' :
+		antithetic = true;
+		break;
+	    case 'b' :
+		blocksize = atoi(optarg);
+		break;
+	    case 'c' :
+		calibrate = atoi(optarg);
+		break;
+	    case 'h' :
+		horizon_years = atof(optarg);
+		break;
+	    case 'i' :
+		index = atoi(optarg);
+		break;
+	    case 'j' :
+		nthreads = atoi(optarg);
+		break;
+	    case 'k' :
+		for (kind = 0; kind < BENCH_KINDS; kind++)
+		    if (strcmp(optarg, bench_kind_name(kind)) == 0)
+			break;
+		break;
+	    case 'n' :
+		npaths = atol(optarg);
+		break;
+	    case 'S' :
+		whole = true;
+		break;
+	    case 's' :
+		seed = strtoul(optarg, NULL, 10);
+		break;
+	    case 'T' :
+		layout = TIME_MAJOR;
+		break;
+	    case 'w' :
+		pathfile = optarg;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    if (kind == BENCH_KINDS || index < 0 || npaths < 1 || calibrate < 2 ||
+	horizon_years <= 0) {
+	usage();
+	return 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+
+    init(keyfile);
+
+    std::vector<BenchBond> bonds;
+    if (bench_portfolio(index + 1, bonds) == 0) {
+	fprintf(stderr, "Error: benchmark portfolio failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    BenchBond &bench = bonds[kind * (index + 1) + index];
+
+    AKACURVE *curve = bench_curve();
+    AKAHTREE tree = AKATreeFit(curve, NULL);
+    if (tree == 0) {
+	fprintf(stderr, "Error: tree fit failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    PathBond b;
+    b.bond = bench.bond;
+    b.pvdate = BENCH_PVDATE;
+    b.horizon = AKADateAdd(b.pvdate, horizon_years, AKA_DAYS_ACT_ACT);
+    b.oas = bench.oas;
+    b.price = AKABondPrice(b.pvdate, tree, b.bond, b.oas);
+    AKATreeRelease(tree);
+
+	/* monthly to the horizon, the benchmark curve's maturities */
+    std::vector<double> times, mats(curve->time, curve->time + curve->n);
+    for (int k = 1; k <= (int) ceil(horizon_years * 12); k++)
+	times.push_back(k / 12.);
+
+    std::chrono::steady_clock::time_point start =
+	std::chrono::steady_clock::now();
+    struct TREESAMPLE *sample = NULL;
+    PathSource *src;
+    WalkPaths walks;
+    if (whole) {
+	long n = antithetic ? (npaths + 1) / 2 : npaths;
+	sample = AKA_treesample_alloc((int) mats.size(), (int) n,
+				      (int) times.size());
+	std::copy(mats.begin(), mats.end(), sample->mats);
+	std::copy(times.begin(), times.end(), sample->times);
+	if (AKA_treesample(curve, sample) != 0) {
+	    fprintf(stderr, "Error: tree sample failed: %s\n",
+		    AKAErrorString(AKAError()));
+	    return 1;
+	}
+	src = new SamplePaths(sample);
+    }
+    else {
+	walks.SetSeed(seed);
+	enum AKA_ERROR_NUMBER error =
+	    walks.Calibrate(curve, mats, times, calibrate);
+	if (error != AKA_ERROR_NONE) {
+	    fprintf(stderr, "Error: tree sample failed: %s\n",
+		    AKAErrorString(error));
+	    return 1;
+	}
+	src = &walks;
+    }
+    src->SetAntithetic(antithetic);
+    std::chrono::duration<double> setup =
+	std::chrono::steady_clock::now() - start;
+
+    if (pathfile != NULL) {
+	start = std::chrono::steady_clock::now();
+	PathBuffer out;
+	std::string error = out.Map(pathfile, layout, 0, src->Mats(),
+				    (int) npaths, src->Times());
+	if (!error.empty() ||
+	    !path_generate(*src, npaths, blocksize, nthreads, out)) {
+	    fprintf(stderr, "Error: %s\n", error.empty() ?
+		    "too few paths in the sample" : error.c_str());
+	    return 1;
+	}
+	std::chrono::duration<double> written =
+	    std::chrono::steady_clock::now() - start;
+	printf("%ld paths written to %s, %d threads, %.3f seconds\n", npaths,
+	       pathfile, nthreads, written.count());
+    }
+
+    start = std::chrono::steady_clock::now();
+    PathResult res;
+    if (path_analyze(*src, b, npaths, blocksize, nthreads, res) < 0) {
+	fprintf(stderr, "Error: bond flows failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    std::chrono::duration<double> elapsed =
+	std::chrono::steady_clock::now() - start;
+
+    printf("%s, price %.4f at oas %g, horizon %ld\n", b.bond->sec->name,
+	   b.price, b.oas, b.horizon);
+    printf("%ld paths%s, %d threads, setup %.3f seconds, "
+	   "paths %.3f seconds\n", res.npaths, antithetic ? " antithetic" : "",
+	   nthreads, setup.count(), elapsed.count());
+    if (res.failed > 0)
+	printf("%ld paths failed, their blocks could not be filled\n",
+	       res.failed);
+    printf("\ntotal return, %%: mean %.4f\n", res.Mean());
+    static const double pcts[] = {.01, .05, .25, .5, .75, .95, .99};
+    for (size_t i = 0; i < sizeof(pcts) / sizeof(pcts[0]); i++)
+	printf("%6.0f%% %10.4f\n", 100 * pcts[i], res.Percentile(pcts[i]));
+    if (!res.calldates.empty()) {
+	printf("\n%10s %10s %10s\n", "call date", "called", "by date");
+	long total = 0;
+	for (size_t i = 0; i < res.calldates.size(); i++) {
+	    total += res.calls[i];
+	    printf("%10ld %10.4f %10.4f\n", res.calldates[i],
+		   (double) res.calls[i] / res.npaths,
+		   (double) total / res.npaths);
+	}
+    }
+
+    if (sample != NULL) {
+	delete src;
+	AKA_treesample_free(sample);
+    }
+    bench_portfolio_free(bonds);
+    AKACurveFree(curve);
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: path based total return and call probabilities "
+	   "of a benchmark bond\n");
+    printf("Usage: [FLAGS]\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-A -- antithetic paths\n"
+	"\t-b <cnt> -- paths per block, default 1000\n"
+	"\t-c <cnt> -- calibration sample paths, default 500\n"
+	"\t-h <years> -- horizon, default 1\n"
+	"\t-i <index> -- bond of the benchmark kind, default 0\n"
+	"\t-j <cnt> -- number of threads, default one per core\n");
+    printf(
+	"\t-k <kind> -- benchmark kind, default callable\n"
+	"\t-n <cnt> -- number of paths, default 10000\n"
+	"\t-S -- use the paths of one AKA_treesample() of the full size\n"
+	"\t-s <seed> -- seed of the generated paths\n"
+	"\t-T -- write the paths time major, default path major\n"
+	"\t-w <file> -- write the paths to a file\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
@@ -0,0 +1,575 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Scenario analysis of the bonds of AKACalc data files under a grid of
+   rate shifts and horizons, on several threads.
+
+   The grid is built before the first bond is read.  The initial tree
+   is fitted once, and each shifted curve once, its tree shared by all
+   the horizons; with -g the environments in between are fitted once
+   per shift and horizon (see scensetup.hpp).  The bonds are then read
+   in blocks, and each block is analyzed under the whole grid by
+   scen_batch() (see scenbatch.hpp), which solves a price for the OAS
+   once per bond rather than once per scenario.  Each bond is frozen at
+   the pvdate (see frozenbond.hpp), as a block with fewer bonds than
+   threads splits each bond's scenarios across the threads.  The
+   scenarios start on the pvdate for every bond, so a price with a
+   trade date is refused rather than settled differently.
+   The bond file may be text or the binary form written by akacalc2bin.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "akacalc_binary.hpp"
+#include "frozenbond.hpp"
+#include "scensetup.hpp"
+#include "scenbatch.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+
+/* -----------------------------------------------------------------
+   Purpose: parse a comma separated list of numbers, e.g., -100,0,100
+   Returns: number of values, 0 if any is bad
+   ----------------------------------------------------------------- */
+static size_t
+parse_list(const char *list, std::vector<double> &values)
+{
+    values.clear();
+    while (*list != '\0') {
+	char *end;
+	double v = strtod(list, &end);
+	if (end == list || (*end != ',' && *end != '\0'))
+	    return 0;
+	values.push_back(v);
+	list = (*end == ',') ? end + 1 : end;
+    }
+    return values.size();
+}
+
+/* -----------------------------------------------------------------
+   The scenario grid, horizon major: the setup of horizon h and shift
+   s is setups[h * nshifts + s].  The trees are fitted once and shared
+   by the setups; all of them are released by Release(), which must
+   come before AKA_shutdown(), or else by the destructor.
+   ----------------------------------------------------------------- */
+class ScenGrid {
+private:     // disallow copy, assignment
+    ScenGrid(const ScenGrid &);
+    ScenGrid & operator=(const ScenGrid &);
+
+    AKAHTREE initial;
+    std::vector<AKAHTREE> shifted;	/* one per shift, 0 bp is initial */
+    std::vector<AKASCENSETUP *> fixed;	/* the AKA_SCEN_NOW setups */
+    std::vector<StepScenario *> stepped;
+public:
+    std::vector<const AKASCENSETUP *> setups;
+    std::vector<std::string> names;
+
+    ScenGrid() : initial(0) {};
+    ~ScenGrid() { Release(); };
+
+	// free the setups and release the trees, the grid is then empty
+    void Release() {
+	for (size_t i = 0; i < fixed.size(); i++)
+	    AKAScenSetupFree(fixed[i]);
+	for (size_t i = 0; i < stepped.size(); i++)
+	    delete stepped[i];
+	for (size_t i = 0; i < shifted.size(); i++)
+	    if (shifted[i] != initial)
+		AKATreeRelease(shifted[i]);
+	if (initial != 0)
+	    AKATreeRelease(initial);
+	initial = 0;
+	fixed.clear();
+	stepped.clear();
+	shifted.clear();
+	setups.clear();
+	names.clear();
+    };
+
+	/* Build a setup for every horizon, in years, and every shift of
+	   the par curve, in basis points.  With steps of 0 rates move at
+	   once, otherwise in that many steps to the horizon.  Returns
+	   false with the library error set if a fit fails. */
+    bool Build(long pvdate, const AKACURVE *curve,
+	       const std::vector<double> &horizons,
+	       const std::vector<double> &shifts, int steps) {
+	std::vector<AKACURVE *> ends;
+	bool ok = (initial = AKATreeFit(curve, NULL)) != 0;
+
+	for (size_t s = 0; ok && s < shifts.size(); s++) {
+	    AKACURVE *end = AKACurveCopy(curve);
+	    for (long i = 0; i < end->n; i++)
+		end->yield[i] += shifts[s] / 100;
+	    ends.push_back(end);
+	    AKAHTREE tree = (shifts[s] == 0) ? initial : AKATreeFit(end, NULL);
+	    if (tree == 0)
+		ok = false;
+	    else
+		shifted.push_back(tree);
+	}
+	for (size_t h = 0; ok && h < horizons.size(); h++) {
+	    long horizon = AKADateAdd(pvdate, horizons[h], AKA_DAYS_ACT_ACT);
+	    for (size_t s = 0; ok && s < shifts.size(); s++) {
+		char name[50];
+		snprintf(name, sizeof(name), "%gy:%gbp", horizons[h], shifts[s]);
+		names.push_back(name);
+		if (steps > 0) {
+		    StepScenario *step = new StepScenario;
+		    stepped.push_back(step);
+		    ok = step->Build(pvdate, horizon, curve, ends[s], steps,
+				     initial, shifted[s]);
+		    setups.push_back(step->Setup());
+		}
+		else {
+		    AKASCENSETUP *setup = AKAScenSetupAlloc(2);
+		    setup->type = AKA_SCEN_NOW;
+		    setup->dates[0] = pvdate;
+		    setup->trees[0] = initial;
+		    setup->dates[1] = horizon;
+		    setup->trees[1] = shifted[s];
+		    fixed.push_back(setup);
+		    setups.push_back(setup);
+		}
+	    }
+	}
+	for (size_t s = 0; s < ends.size(); s++)
+	    AKACurveFree(ends[s]);
+	return ok;
+    };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *couponfile = NULL;
+    const char *pricefile = NULL;
+    std::vector<double> horizons(1, 1.0);
+    std::vector<double> shifts;
+    double oas = 0;
+    int steps = 0;
+    int nthreads = (int) std::thread::hardware_concurrency();
+    int blocksize = 1024;
+    bool header = false;
+    bool timing = false;
+    bool verify = false;
+    bool quiet = false;
+
+    parse_list("-200,-100,0,100,200", shifts);
+    while((c = getopt(argc, argv, "a:b:C:g:Hh:j:o:P:s:tvz"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'b' :
+		blocksize = atoi(optarg);
+		break;
+	    case 'C' :
+		couponfile = optarg;
+		break;
+	    case 'g' :
+		steps = atoi(optarg);
+		break;
+	    case 'H' :
+		header = true;
+		break;
+	    case 'h' :
+		if (parse_list(optarg, horizons) == 0) {
+		    fprintf(stderr, "Error: bad horizons %s\n", optarg);
+		    return 1;
+		}
+		break;
+	    case 'j' :
+		nthreads = atoi(optarg);
+		break;
+	    case 'o' :
+		oas = atof(optarg);
+		break;
+	    case 'P' :
+		pricefile = optarg;
+		break;
+	    case 's' :
+		if (parse_list(optarg, shifts) == 0) {
+		    fprintf(stderr, "Error: bad shifts %s\n", optarg);
+		    return 1;
+		}
+		break;
+	    case 't' :
+		timing = true;
+		break;
+	    case 'v' :
+		verify = true;
+		break;
+	    case 'z' :
+		quiet = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 3) {
+	usage();
+	return 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+    if (blocksize < 1)
+	blocksize = 1;
+
+    long pvdate = akadatecnv(argv[0]);
+    const char *yieldfile = argv[1];
+    const char *bondfile = argv[2];
+    const char *callfile = argc > 3 ? argv[3] : NULL;
+    const char *putfile = argc > 4 ? argv[4] : NULL;
+    const char *sinkfile = argc > 5 ? argv[5] : NULL;
+
+    init(keyfile);
+
+    std::string error;
+    AKACURVE *curve = read_yield_curve(yieldfile, pvdate, error);
+    if (curve == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    clock_t start = clock();
+    ScenGrid grid;
+    bool built = grid.Build(pvdate, curve, horizons, shifts, steps);
+    double setupsecs = INSECS(clock() - start);
+    AKACurveFree(curve);
+    if (!built) {
+	fprintf(stderr, "Error: scenario setup failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    size_t nsetups = grid.setups.size();
+
+    BondSpecReader textspecs;
+    BinaryBondFile binspecs;
+    BondSource *specs = open_bond_source(bondfile, callfile, putfile,
+					 sinkfile, couponfile, textspecs,
+					 binspecs, error);
+    if (specs == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    PriceReader prices;
+    if (pricefile != NULL && !prices.Open(pricefile, pvdate)) {
+	fprintf(stderr, "Error: unable to open %s\n", pricefile);
+	return 1;
+    }
+
+    if (header && !quiet) {
+	printf("key");
+	for (size_t s = 0; s < nsetups; s++)
+	    printf(" %s", grid.names[s].c_str());
+	printf("\n");
+    }
+
+    start = clock();
+    time_t wallstart = time(NULL);
+    long nbonds = 0, failed = 0;
+    double maxdiff = 0;
+    std::vector<BondSpec> specblock(blocksize);
+    std::vector<std::string> errors(blocksize);
+    std::vector<std::shared_ptr<const FrozenBond> > frozen(blocksize);
+    std::vector<ScenBatchBond> batch;
+    std::vector<AKASCENREPORT> rpts;
+    std::vector<enum AKA_ERROR_NUMBER> errs;
+    bool more = true;
+
+    while (more) {
+	int n = 0;
+	batch.clear();
+	while (n < blocksize && (more = specs->Next(specblock[n]))) {
+	    BondSpec &spec = specblock[n];
+	    PriceRecord price;
+	    errors[n] = spec.error;
+	    if (spec.bond != NULL && pricefile != NULL) {
+		if (!prices.Find(spec.key, price))
+		    errors[n] = "no price on pvdate";
+		else if (price.tradedate != 0)
+		    errors[n] = "trade dates are not supported";
+		else if (price.outstanding >= 0 && spec.bond->sink != NULL &&
+			 spec.bond->sink->n > 0)
+		    spec.bond->sink->outstanding = price.outstanding;
+	    }
+	    if (errors[n].empty()) {
+		frozen[n] = FrozenBond::Freeze(spec.bond, pvdate);
+		if (frozen[n] == NULL)
+		    errors[n] = AKAErrorString(AKAError());
+		else if (frozen[n]->Error() != AKA_ERROR_NONE)
+		    errors[n] = AKAErrorString(frozen[n]->Error());
+	    }
+	    if (errors[n].empty()) {
+		ScenBatchBond b;
+		b.bond = frozen[n]->Bond();
+		b.quotetype = pricefile != NULL ? AKA_QUOTE_PRICE : AKA_QUOTE_OAS;
+		b.quote = pricefile != NULL ? price.price : oas;
+		batch.push_back(b);
+	    }
+	    n++;
+	}
+	if (n == 0)
+	    break;
+
+	rpts.resize(batch.size() * nsetups);
+	errs.resize(batch.size() * nsetups);
+	failed += scen_batch(batch.empty() ? NULL : &batch[0], batch.size(),
+			     &grid.setups[0], nsetups, nthreads,
+			     rpts.empty() ? NULL : &rpts[0],
+			     errs.empty() ? NULL : &errs[0]);
+
+	    /* compare with a scenario run per cell from the quote */
+	if (verify) {
+	    for (size_t i = 0; i < batch.size(); i++) {
+		for (size_t s = 0; s < nsetups; s++) {
+		    AKASCENREPORT rpt;
+		    double efficiency;
+		    memset(&rpt, 0, sizeof(rpt));
+		    AKABondScenEx(batch[i].quotetype, batch[i].quote,
+				  grid.setups[s], batch[i].bond, &rpt,
+				  &efficiency);
+		    if (AKAError() == AKA_ERROR_NONE &&
+			errs[i * nsetups + s] == AKA_ERROR_NONE) {
+			double d = fabs(rpt.totalRet -
+					rpts[i * nsetups + s].totalRet);
+			if (d > maxdiff)
+			    maxdiff = d;
+		    }
+		}
+	    }
+	}
+
+	size_t k = 0;
+	for (int i = 0; i < n; i++) {
+	    const char *key = specblock[i].key.c_str();
+	    if (!errors[i].empty()) {
+		if (!quiet)
+		    printf("%s ERROR %s\n", key, errors[i].c_str());
+	    }
+	    else {
+		if (!quiet) {
+		    printf("%s", key);
+		    for (size_t s = 0; s < nsetups; s++) {
+			if (errs[k * nsetups + s] != AKA_ERROR_NONE)
+			    printf(" ERROR");
+			else
+			    printf(" %.6f", rpts[k * nsetups + s].totalRet);
+		    }
+		    printf("\n");
+		}
+		k++;
+	    }
+	    AKABondFree(specblock[i].bond);
+	    specblock[i].bond = NULL;
+	    frozen[i].reset();
+	    nbonds++;
+	}
+    }
+
+    if (specs->Orphans() > 0)
+	fprintf(stderr, "Warning: %ld option, sink, or coupon records "
+		"without a bond record\n", specs->Orphans());
+    if (failed > 0)
+	fprintf(stderr, "Warning: %ld scenarios failed\n", failed);
+    if (verify)
+	fprintf(stderr, "largest difference from a scenario per cell = %g\n",
+		maxdiff);
+    if (timing)
+	fprintf(stderr, "%ld bonds, %d scenarios, %d threads, "
+		"setup cpu seconds = %0.2f, cpu seconds = %0.2f, "
+		"elapsed seconds = %ld\n",
+		nbonds, (int) nsetups, nthreads, setupsecs,
+		INSECS(clock() - start), (long) (time(NULL) - wallstart));
+
+    grid.Release();
+    specs->Release();
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: scenario analysis of the bonds of AKACalc data files "
+	   "under a grid\n\tof rate shifts and horizons\n");
+    printf("Usage: [FLAGS] <pvdate> <yield-file> <bond-file> "
+	   "[<call-file> [<put-file> [<sink-file>]]]\n");
+    printf("Use - in place of an unused call or put file name.\n");
+    printf("The bond file may be a binary file from akacalc2bin, "
+	   "without other files.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-b <cnt> -- bonds analyzed per block, default 1024\n"
+	"\t-C <coupon-file> -- step up/down coupon file\n"
+	"\t-g <steps> -- move rates to the horizon in steps, default at once\n"
+	"\t-H -- write a header line naming the scenarios\n"
+	"\t-h <years,...> -- horizons, default 1\n"
+	"\t-j <cnt> -- number of threads, default one per core\n");
+    printf(
+	"\t-o <oas> -- quote at oas when there is no price file, default 0\n"
+	"\t-P <price-file> -- quote at the prices for the pvdate, "
+	"without trade dates\n"
+	"\t-s <bp,...> -- par curve shifts, default -200,-100,0,100,200\n"
+	"\t-t -- display timings on stderr\n"
+	"\t-v -- verify against a scenario run per cell, on stderr\n"
+	"\t-z -- silent mode, no output, for timing\n");
+    printf(
+	"\nOutput, one line per bond record, in input order:\n"
+	"\tkey totalRet... (horizon major, then shift)\n"
+	"\tkey ERROR message\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
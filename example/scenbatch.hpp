@@ -0,0 +1,147 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Scenario analysis of a portfolio under a grid of scenario setups.
+
+   scen_batch() fills a report for every bond under every setup, on
+   several threads.  Each thread takes the next bond and runs it under
+   all the setups, so the bond's data stays in the thread's cache.  A
+   price quote is turned into an OAS once per bond and initial
+   environment (setup trees[0] and dates[0]), rather than once per
+   setup, and the setups then run from the OAS.  Build the setups so
+   that they share trees: one initial tree for the grid, and one tree
+   per shifted curve for all the horizons that use it.
+
+   A batch of fewer bonds than threads, such as the last block of a
+   file, would leave threads idle.  Each bond's setups are then split
+   into parts run on different threads, at the cost of solving the OAS
+   once per part, and the bond is read by several threads at once;
+   freeze such bonds first (see frozenbond.hpp).
+   ------------------------------------------------------------------------- */
+#ifndef _SCENBATCH_HPP_
+#define _SCENBATCH_HPP_
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "akaapi.h"
+#include "sinkstate.hpp"
+#include "workqueue.hpp"
+
+/* a bond of the batch and its quote, as for AKABondScenEx() */
+struct ScenBatchBond {
+    const AKABOND *bond;
+    long quotetype;
+    double quote;
+};
+
+/* -----------------------------------------------------------------
+   Purpose: analyze one bond under all the setups.  A non-negative
+	    price is solved for the OAS once per initial environment; a
+	    negative price (zero OAS analysis) and the yield quotes are
+	    passed through unchanged.  A sinker is prepared once per
+	    initial date (see sinkstate.hpp).
+   Returns: nothing, the reports and errors of the bond are filled in
+   ----------------------------------------------------------------- */
+inline void
+scen_batch_bond(const ScenBatchBond &b, const AKASCENSETUP *const *setups,
+		size_t nsetups, AKASCENREPORT *rpts,
+		enum AKA_ERROR_NUMBER *errors)
+{
+    struct Initial {
+	AKAHTREE tree;
+	long date;
+	double oas;
+	enum AKA_ERROR_NUMBER error;
+    };
+    std::vector<Initial> initials;
+    SinkState sinks;
+    bool solve = b.quotetype == AKA_QUOTE_PRICE && b.quote >= 0;
+
+    for (size_t s = 0; s < nsetups; s++) {
+	const AKASCENSETUP *setup = setups[s];
+	long quotetype = b.quotetype;
+	double quote = b.quote;
+	enum AKA_ERROR_NUMBER error = AKA_ERROR_NONE;
+	const AKABOND *bond = sinks.Prepare(setup->dates[0], b.bond);
+
+	if (bond == NULL)
+	    error = AKA_ERROR_MEMORY;
+	else if (solve) {
+	    size_t k = 0;
+	    while (k < initials.size() && (initials[k].tree != setup->trees[0]
+					  || initials[k].date != setup->dates[0]))
+		k++;
+	    if (k == initials.size()) {
+		Initial init;
+		init.tree = setup->trees[0];
+		init.date = setup->dates[0];
+		init.oas = AKABondOAS(init.date, init.tree, bond, b.quote);
+		init.error = AKAError();
+		initials.push_back(init);
+	    }
+	    quotetype = AKA_QUOTE_OAS;
+	    quote = initials[k].oas;
+	    error = initials[k].error;
+	}
+
+	memset(&rpts[s], 0, sizeof(rpts[s]));
+	if (error == AKA_ERROR_NONE) {
+	    double efficiency;
+	    AKABondScenEx(quotetype, quote, setup, bond, &rpts[s],
+			  &efficiency);
+	    error = AKAError();
+	}
+	if (errors != NULL)
+	    errors[s] = error;
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: analyze every bond under every setup on nthreads threads.
+	    The reports and errors are nbonds by nsetups matrices, the
+	    cell of bond i and setup s at i * nsetups + s.  errors may be
+	    NULL.  Bonds and setups are only read, and may be shared with
+	    other threads.  With fewer bonds than threads, a bond's
+	    setups are split across threads.
+   Returns: number of cells which failed
+   ----------------------------------------------------------------- */
+inline long
+scen_batch(const ScenBatchBond *bonds, size_t nbonds,
+	   const AKASCENSETUP *const *setups, size_t nsetups, int nthreads,
+	   AKASCENREPORT *rpts, enum AKA_ERROR_NUMBER *errors)
+{
+    std::atomic<long> failed(0);
+
+    if (nbonds == 0 || nsetups == 0)
+	return 0;
+    size_t parts = 1;
+    if (nthreads > 1 && nbonds < (size_t) nthreads)
+	parts = std::min(nsetups, (nthreads + nbonds - 1) / nbonds);
+    size_t per = (nsetups + parts - 1) / parts;
+    std::vector<std::vector<enum AKA_ERROR_NUMBER> > errs(
+	std::max(nthreads, 1), std::vector<enum AKA_ERROR_NUMBER>(per));
+
+	/* part c is setups first.. of bond c / parts */
+    parallel_for((long) (nbonds * parts), nthreads, [&](long c, int t) {
+	size_t i = c / parts, first = c % parts * per;
+	if (first >= nsetups)
+	    return;
+	size_t n = std::min(per, nsetups - first);
+	scen_batch_bond(bonds[i], setups + first, n,
+			&rpts[i * nsetups + first], &errs[t][0]);
+	for (size_t s = 0; s < n; s++) {
+	    if (errs[t][s] != AKA_ERROR_NONE)
+		failed++;
+	    if (errors != NULL)
+		errors[i * nsetups + first + s] = errs[t][s];
+	}
+    });
+    return failed;
+}
+
+#endif // ifndef _SCENBATCH_HPP_
@@ -0,0 +1,323 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Gradual scenario analysis with the environments fitted once per
+   scenario (see scensetup.hpp) compared with AKA_SCEN_GRADUAL.
+
+   The bonds are the benchmark portfolios.  The horizon curve is the
+   initial curve shifted by -s basis points.  For each number of steps
+   the program reports the time of both approaches, including fitting
+   the steps, and how far the step approximation's total returns are
+   from those of AKA_SCEN_GRADUAL.  Bonds which fail in either are
+   counted and left out of the differences.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <vector>
+
+#include "akaapi.h"
+#include "benchportfolio.hpp"
+#include "scensetup.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+
+/* -----------------------------------------------------------------
+   Purpose: total return of each bond under a scenario setup
+   Returns: number of bonds which failed, valued[i] is false for them
+   ----------------------------------------------------------------- */
+static int
+scen_returns(const AKASCENSETUP *setup, const std::vector<BenchBond> &bonds,
+	     std::vector<double> &totalret, std::vector<bool> &valued)
+{
+    int failed = 0;
+    totalret.assign(bonds.size(), 0);
+    valued.assign(bonds.size(), false);
+    for (size_t i = 0; i < bonds.size(); i++) {
+	AKASCENREPORT rpt;
+	double efficiency;
+	memset(&rpt, 0, sizeof(rpt));
+	AKABondScenEx(AKA_QUOTE_OAS, bonds[i].oas, setup, bonds[i].bond,
+		      &rpt, &efficiency);
+	if (AKAError() != AKA_ERROR_NONE)
+	    failed++;
+	else {
+	    totalret[i] = rpt.totalRet;
+	    valued[i] = true;
+	}
+    }
+    return failed;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *stepslist = "1,2,4,12";
+    int count = 50;
+    double horizon_years = 1;
+    double shift = -100;
+
+    while((c = getopt(argc, argv, "a:h:k:n:s:"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'h' :
+		horizon_years = atof(optarg);
+		break;
+	    case 'k' :
+		stepslist = optarg;
+		break;
+	    case 'n' :
+		count = atoi(optarg);
+		break;
+	    case 's' :
+		shift = atof(optarg);
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    if (count < 1 || horizon_years <= 0) {
+	usage();
+	return 1;
+    }
+
+    init(keyfile);
+
+    long pvdate = BENCH_PVDATE;
+    long horizon = AKADateAdd(pvdate, horizon_years, AKA_DAYS_ACT_ACT);
+    AKACURVE *start = bench_curve();
+    AKACURVE *end = AKACurveCopy(start);
+    for (long i = 0; i < end->n; i++)
+	end->yield[i] += shift / 100;
+
+    std::vector<BenchBond> bonds;
+    if (bench_portfolio(count, bonds) == 0) {
+	fprintf(stderr, "Error: benchmark portfolio failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+
+	/* the library's gradual scenario, the reference */
+    clock_t ticks = clock();
+    AKASCENSETUP *gradual = AKAScenSetupAlloc(2);
+    gradual->type = AKA_SCEN_GRADUAL;
+    gradual->dates[0] = pvdate;
+    gradual->dates[1] = horizon;
+    gradual->trees[0] = AKATreeFit(start, NULL);
+    gradual->trees[1] = AKATreeFit(end, NULL);
+    if (gradual->trees[0] == 0 || gradual->trees[1] == 0) {
+	fprintf(stderr, "Error: tree fit failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+    std::vector<double> reference;
+    std::vector<bool> refvalued;
+    int failed = scen_returns(gradual, bonds, reference, refvalued);
+    double gradual_secs = INSECS(clock() - ticks);
+
+    printf("%d bonds, horizon %ld, shift %g bp\n", (int) bonds.size(),
+	   horizon, shift);
+    printf("AKA_SCEN_GRADUAL: %0.3f seconds, %d failed\n", gradual_secs,
+	   failed);
+    printf("%6s %10s %10s %7s %12s %12s  %s\n", "steps", "fit secs",
+	   "scen secs", "failed", "max diff", "mean diff", "worst kind");
+
+    for (const char *p = stepslist; *p != '\0'; ) {
+	char *next;
+	int steps = (int) strtol(p, &next, 10);
+	if (next == p || steps < 1) {
+	    fprintf(stderr, "Error: bad steps list %s\n", stepslist);
+	    return 1;
+	}
+	p = (*next == ',') ? next + 1 : next;
+
+	ticks = clock();
+	StepScenario scen;
+	if (!scen.Build(pvdate, horizon, start, end, steps)) {
+	    fprintf(stderr, "Error: step scenario failed: %s\n",
+		    AKAErrorString(AKAError()));
+	    return 1;
+	}
+	double fit_secs = INSECS(clock() - ticks);
+	ticks = clock();
+	std::vector<double> totalret;
+	std::vector<bool> valued;
+	int stepfailed = scen_returns(scen.Setup(), bonds, totalret, valued);
+	double scen_secs = INSECS(clock() - ticks);
+
+	    /* only the bonds both runs valued */
+	double maxdiff = 0, sumdiff = 0;
+	int worst = 0, compared = 0;
+	for (size_t i = 0; i < bonds.size(); i++) {
+	    if (!valued[i] || !refvalued[i])
+		continue;
+	    compared++;
+	    double diff = fabs(totalret[i] - reference[i]);
+	    sumdiff += diff;
+	    if (diff > maxdiff) {
+		maxdiff = diff;
+		worst = bonds[i].kind;
+	    }
+	}
+	printf("%6d %10.3f %10.3f %7d %12.6f %12.6f  %s\n", steps, fit_secs,
+	       scen_secs, stepfailed, maxdiff,
+	       compared > 0 ? sumdiff / compared : 0, bench_kind_name(worst));
+    }
+
+    bench_portfolio_free(bonds);
+    AKATreeRelease(gradual->trees[0]);
+    AKATreeRelease(gradual->trees[1]);
+    AKAScenSetupFree(gradual);
+    AKACurveFree(start);
+    AKACurveFree(end);
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: compare fitted-once gradual scenarios with "
+	   "AKA_SCEN_GRADUAL\n");
+    printf("Usage: [FLAGS]\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-h <years> -- horizon, default 1\n"
+	"\t-k <steps,...> -- numbers of steps to try, default 1,2,4,12\n"
+	"\t-n <cnt> -- bonds of each benchmark kind, default 50\n"
+	"\t-s <bp> -- shift of the horizon curve, default -100\n");
+    printf(
+	"\nDifferences are in total return per $100 face, against "
+	"AKA_SCEN_GRADUAL,\n"
+	"over the bonds valued by both.\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
@@ -0,0 +1,104 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   An InterestRateScenario prepared once for many bonds, for the C++
+   API.
+
+   A GRADUAL InterestRateScenario holds only the initial and horizon
+   models, and each Value::AnalyzeScenario() derives the models in
+   between for the bond analyzed.  PreparedScenario derives them once:
+   Prepare() interpolates the curves between the two models, solves a
+   model for each step, and adds it to a THEN scenario as a transition.
+   Every bond analyzed under Scenario() then reuses the solved models.
+   The steps approximate the linear path as in scensetup.hpp, which
+   does the same for the C API.
+
+   The reinvestment and efficiency settings are those of the scenario
+   returned by Scenario(), and are set on it as usual.
+   ------------------------------------------------------------------------- */
+#ifndef _SCENPREPARE_HPP_
+#define _SCENPREPARE_HPP_
+
+#include <vector>
+
+#include "akaapi.hpp"
+#include "akaapi_compatibility.hpp"
+#include "scensetup.hpp"
+
+class PreparedScenario {
+private:     // disallow copy, assignment
+    PreparedScenario(const PreparedScenario &);
+    PreparedScenario & operator=(const PreparedScenario &);
+
+    AndrewKalotayAssociates::InterestRateScenario *scenario;
+    std::vector<AndrewKalotayAssociates::InterestRateModel *> models;
+    int error;
+
+    void Release() {
+	delete scenario;
+	scenario = NULL;
+	for (size_t i = 0; i < models.size(); i++)
+	    delete models[i];
+	models.clear();
+    };
+public:
+    PreparedScenario() : scenario(NULL), error(0) {};
+    ~PreparedScenario() { Release(); };
+
+	/* Build the scenario from the solved initial model to the
+	   solved horizon model, years in the future, in steps.  One
+	   step is the THEN scenario of the horizon model alone.
+	   Returns Error(), like InterestRateModel::Solve(). */
+    int Prepare(const AndrewKalotayAssociates::InterestRateModel &initial,
+		double years,
+		const AndrewKalotayAssociates::InterestRateModel &horizon,
+		int steps) {
+	using namespace AndrewKalotayAssociates;
+	Release();
+	error = AKA_ERROR_NONE;
+	if (steps < 1)
+	    steps = 1;
+	const AKACURVE *start = Compatibility::CApiCurve(initial);
+	const AKACURVE *end = Compatibility::CApiCurve(horizon);
+
+	scenario = new InterestRateScenario(years, horizon,
+					    InterestRateScenario::THEN);
+	for (int k = 1; k < steps; k++) {
+	    AKACURVE *curve = curve_between(start, end, (double) k / steps);
+	    if (curve == NULL) {
+		error = AKA_ERROR_CURVE;
+		break;
+	    }
+	    InterestRateModel *model =
+		new InterestRateModel(Compatibility::ModelFromCurve(curve));
+	    AKACurveFree(curve);
+	    models.push_back(model);
+	    if ((error = model->Solve()) != AKA_ERROR_NONE)
+		break;
+	    if (!scenario->AddTransition(years * k / steps, *model)) {
+		error = AKA_ERROR_HTREE;	/* the model was refused */
+		break;
+	    }
+	}
+	if (error != AKA_ERROR_NONE)
+	    Release();
+	return error;
+    };
+
+	// the error of the last Prepare(), AKA_ERROR_NONE if it succeeded
+    int Error() const { return error; };
+    const char *ErrorString() const {
+	return AndrewKalotayAssociates::Status::ErrorString(error);
+    };
+
+	// valid after a successful Prepare()
+    const AndrewKalotayAssociates::InterestRateScenario &Scenario() const {
+	return *scenario;
+    };
+    AndrewKalotayAssociates::InterestRateScenario &Scenario() {
+	return *scenario;
+    };
+};
+
+#endif // ifndef _SCENPREPARE_HPP_
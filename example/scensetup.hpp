@@ -0,0 +1,173 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Scenario setups built once and shared by every bond analyzed under
+   them.
+
+   AKA_SCEN_GRADUAL moves rates linearly from the initial environment
+   to the horizon environment, and the library derives the environments
+   in between for each bond analyzed.  StepScenario instead fits the
+   environments in between once, from curves interpolated between the
+   initial and horizon curves, and hands AKABondScenEx() a setup in
+   which each of them takes effect on its own date.  Per bond the cost
+   is then that of a scenario with that many fixed environments.
+
+   The steps are a staircase approximation of the linear path: rates
+   lag it by at most one step and the difference shrinks with the
+   number of steps.  scengradual measures the difference against
+   AKA_SCEN_GRADUAL for a portfolio, so the number of steps can be
+   chosen for the precision wanted.
+   ------------------------------------------------------------------------- */
+#ifndef _SCENSETUP_HPP_
+#define _SCENSETUP_HPP_
+
+#include <math.h>
+
+#include <vector>
+
+#include "akaapi.h"
+
+/* -----------------------------------------------------------------
+   Purpose: continuous zero rate of point i of a factor curve; a point
+	    at time 0, whose factor is 1, takes the rate of the next
+	    point
+   Returns: rate, 0 if no point is after time 0
+   ----------------------------------------------------------------- */
+inline double
+curve_zero_rate(const AKACURVE *curve, long i)
+{
+    while (i < curve->n && curve->time[i] <= 0)
+	i++;
+    return i < curve->n ? -log(curve->yield[i]) / curve->time[i] : 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: rate of a curve at a term, linear between the curve
+	    points and flat beyond them
+   Returns: rate, for factor curves the continuous zero rate
+   ----------------------------------------------------------------- */
+inline double
+curve_rate_at(const AKACURVE *curve, double term)
+{
+    long n = curve->n;
+    long i = 0;
+    while (i < n && curve->time[i] < term)
+	i++;
+    long lo = (i == 0) ? 0 : (i == n ? n - 1 : i - 1);
+    long hi = (i == n) ? n - 1 : i;
+    double rlo = curve->yield[lo], rhi = curve->yield[hi];
+    if (curve->type == AKA_CURVE_FACTOR) {
+	rlo = curve_zero_rate(curve, lo);
+	rhi = curve_zero_rate(curve, hi);
+    }
+    if (lo == hi || term <= curve->time[lo])
+	return term > curve->time[hi] ? rhi : rlo;
+    double w = (term - curve->time[lo]) / (curve->time[hi] - curve->time[lo]);
+    return rlo + w * (rhi - rlo);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the curve a fraction w of the way from start to end, on
+	    the terms of start.  Rates and volatility are interpolated
+	    linearly; factor curves through their zero rates.
+   Returns: allocated curve, NULL if the curve types differ
+   ----------------------------------------------------------------- */
+inline AKACURVE *
+curve_between(const AKACURVE *start, const AKACURVE *end, double w)
+{
+    if (start->type != end->type)
+	return NULL;
+    AKACURVE *curve = AKACurveCopy(start);
+    for (long i = 0; i < curve->n; i++) {
+	double t = curve->time[i];
+	double rate = curve_rate_at(start, t) +
+	    w * (curve_rate_at(end, t) - curve_rate_at(start, t));
+	curve->yield[i] = (curve->type == AKA_CURVE_FACTOR) ?
+	    exp(-rate * t) : rate;
+    }
+    curve->vol = start->vol + w * (end->vol - start->vol);
+    curve->lvol = start->lvol + w * (end->lvol - start->lvol);
+    curve->alpha = start->alpha + w * (end->alpha - start->alpha);
+    return curve;
+}
+
+/* -----------------------------------------------------------------
+   A scenario setup with steps environments between the pvdate and
+   the horizon, evenly spaced in time, each fitted once.  The setup
+   and the trees it fitted are owned here; Setup() may be shared by
+   any number of threads for as long as the StepScenario lives.
+   ----------------------------------------------------------------- */
+class StepScenario {
+private:     // disallow copy, assignment
+    StepScenario(const StepScenario &);
+    StepScenario & operator=(const StepScenario &);
+
+    AKASCENSETUP *setup;
+    std::vector<AKAHTREE> trees;
+
+    void Release() {
+	for (size_t i = 0; i < trees.size(); i++)
+	    AKATreeRelease(trees[i]);
+	trees.clear();
+	setup = AKAScenSetupFree(setup);
+    };
+public:
+    StepScenario() : setup(NULL) {};
+    ~StepScenario() { Release(); };
+
+	/* Fit the environments.  The initial environment is fitted from
+	   start, the one at the horizon from end, and steps - 1 from
+	   the curves in between.  One step is AKA_SCEN_THEN.  Trees
+	   already fitted from start or end may be passed in as initial
+	   and final, so that several scenarios share them; they remain
+	   the caller's.  Returns false with the library error set if a
+	   fit fails. */
+    bool Build(long pvdate, long horizon, const AKACURVE *start,
+	       const AKACURVE *end, int steps, AKAHTREE initial = 0,
+	       AKAHTREE final = 0) {
+	Release();
+	if (steps < 1)
+	    steps = 1;
+	double years = AKAYears(pvdate, horizon, AKA_DAYS_ACT_ACT);
+	setup = AKAScenSetupAlloc(steps + 1);
+	setup->type = AKA_SCEN_THEN;
+	for (int k = 0; k <= steps; k++) {
+	    AKAHTREE tree;
+	    bool shared = (k == 0 && initial != 0) ||
+		(k == steps && final != 0);
+	    if (shared)
+		tree = (k == 0) ? initial : final;
+	    else if (k == 0)
+		tree = AKATreeFit(start, NULL);
+	    else if (k == steps)
+		tree = AKATreeFit(end, NULL);
+	    else {
+		AKACURVE *curve = curve_between(start, end, (double) k / steps);
+		if (curve == NULL) {
+		    Release();
+		    return false;
+		}
+		tree = AKATreeFit(curve, NULL);
+		AKACurveFree(curve);
+	    }
+	    if (tree == 0) {
+		Release();
+		return false;
+	    }
+	    if (!shared)
+		trees.push_back(tree);
+	    setup->trees[k] = tree;
+	    setup->dates[k] = (k == steps) ? horizon :
+		AKADateAdd(pvdate, years * k / steps, AKA_DAYS_ACT_ACT);
+	}
+	return true;
+    };
+
+	// the initial tree, e.g., to find the OAS of a price
+    AKAHTREE Initial() const { return setup ? setup->trees[0] : 0; };
+    const AKASCENSETUP *Setup() const { return setup; };
+    AKASCENSETUP *Setup() { return setup; };
+};
+
+#endif // ifndef _SCENSETUP_HPP_
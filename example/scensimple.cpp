@@ -11,6 +11,8 @@ using namespace std;
 
 #include <stdlib.h>
 #include "akaapi.hpp"
+#include "fwdroll.hpp"
+#include "scenprepare.hpp"
 using namespace AndrewKalotayAssociates;
 
 int
@@ -88,8 +90,8 @@ main(int argc, char *argv[])
 	return horizonmodel.Error();
     }
     
-    InterestRateScenario scenario(pvdate.YearsTo(horizondate, Bond::DC_ACT_ACT),
-				  horizonmodel);
+    double years = pvdate.YearsTo(horizondate, Bond::DC_ACT_ACT);
+    InterestRateScenario scenario(years, horizonmodel);
 
     ScenarioAnalysis analysis;
     if (value.AnalyzeScenario(scenario, oas, analysis) == false) {
@@ -113,5 +115,43 @@ main(int argc, char *argv[])
 	cout << endl;		// close redemption line
 	cout << "Horizon price: " << horizonvalue.Price(oas) << endl;
     }
+
+	/* the same move made gradually.  The models in between are
+	   solved once by Prepare(), and the prepared scenario may be
+	   used for any number of bonds. */
+    PreparedScenario gradual;
+    if (gradual.Prepare(initmodel, years, horizonmodel, 12) > 0) {
+	cerr << "Error: " << gradual.ErrorString() << endl;
+	return gradual.Error();
+    }
+    if (value.AnalyzeScenario(gradual.Scenario(), oas, analysis) == false) {
+	cerr << "Error: scenario analysis failed " << value.ErrorString()
+	     << endl;
+	return value.Error();
+    }
+    cout << "Gradual redemption: " << analysis.redeemstring() << endl;
+
+	/* the forwards realized: the initial model rolled forward a
+	   month at a time, each month a transition */
+    vector<double> months;
+    for (int k = 1; k < (int) (years * 12); k++)
+	months.push_back(k / 12.);
+    months.push_back(years);
+    ForwardRoll roll;
+    if (roll.Roll(initmodel, months) > 0) {
+	cerr << "Error: " << roll.ErrorString() << endl;
+	return roll.Error();
+    }
+    InterestRateScenario forwards(years, roll.Model(roll.Size() - 1),
+				  InterestRateScenario::THEN);
+    for (size_t k = 0; k + 1 < roll.Size(); k++)
+	forwards.AddTransition(roll.Horizon(k), roll.Model(k));
+    if (value.AnalyzeScenario(forwards, oas, analysis) == false) {
+	cerr << "Error: scenario analysis failed " << value.ErrorString()
+	     << endl;
+	return value.Error();
+    }
+    cout << "Forwards realized redemption: " << analysis.redeemstring()
+	 << " (" << roll.Distinct() << " models solved)" << endl;
     return 0;
 }
@@ -0,0 +1,126 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Date arithmetic on serial day numbers, and year fractions for arrays
+   of dates.
+
+   Library dates are longs, yyyymmdd, and every AKAYears() and
+   AKADateAdd() takes the date apart into its fields.  A serial day is
+   the number of days since 12/31/1899, so 1/1/1900 is day 1; the days
+   between two dates are a subtraction.  The conversions use a table of
+   the days before each month, and the leap year rule, and nothing
+   else.
+
+   years_batch() does the work of AKAYears() for many dates from one
+   start date.  ACT/360 and ACT/365 year fractions are the serial days
+   between over 360 or 365, a rule with no exceptions, so they are
+   computed here.  The other daycounts are left to AKAYears(): ACT/ACT
+   depends on the library's coupon period convention, and the 30/360
+   rules on its end of month adjustments, which one date of a batch
+   agreeing with the library does not show for the others.  As a guard,
+   the last entry of an ACT batch is checked against the library, and
+   if they differ the whole batch is redone by the library.
+   ------------------------------------------------------------------------- */
+#ifndef _SERIALDATE_HPP_
+#define _SERIALDATE_HPP_
+
+#include "akaapi.h"
+
+#define SERIAL_YEAR_DAYS(y) ((y) * 365 + (y) / 4 - (y) / 100 + (y) / 400)
+
+/* days before the first of each month, and of a year, not a leap year */
+static const long serial_month_start[13] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365
+};
+
+inline bool
+serial_leap(long year)
+{
+    return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+inline long
+serial_month_days(long year, long month)
+{
+    return serial_month_start[month] - serial_month_start[month - 1] +
+	(month == 2 && serial_leap(year));
+}
+
+/* -----------------------------------------------------------------
+   Purpose: serial day of a date, yyyymmdd, on or after 1/1/1900
+   Returns: days since 12/31/1899
+   ----------------------------------------------------------------- */
+inline long
+serial_day(long date)
+{
+    long y = date / 10000, m = date / 100 % 100, d = date % 100;
+    return SERIAL_YEAR_DAYS(y - 1) - SERIAL_YEAR_DAYS(1899) +
+	serial_month_start[m - 1] + (m > 2 && serial_leap(y)) + d;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: date of a serial day
+   Returns: yyyymmdd
+   ----------------------------------------------------------------- */
+inline long
+serial_date(long serial)
+{
+	/* the year from the mean year, corrected by at most one */
+    long days = serial + SERIAL_YEAR_DAYS(1899);
+    long y = (long) (days / 365.2425) + 1;
+    while (SERIAL_YEAR_DAYS(y - 1) >= days)
+	y--;
+    while (SERIAL_YEAR_DAYS(y) < days)
+	y++;
+    long doy = days - SERIAL_YEAR_DAYS(y - 1);
+    long leap = serial_leap(y);
+    long m = doy / 32 + 1;	/* the month or the one before it */
+    if (m < 12 && doy > serial_month_start[m] + (m >= 2 && leap))
+	m++;
+    return y * 10000 + m * 100 +
+	doy - serial_month_start[m - 1] - (m > 2 && leap);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the year fraction from adate to bdate without the library,
+	    for ACT/360 and ACT/365
+   Returns: false for any other daycount
+   ----------------------------------------------------------------- */
+inline bool
+serial_years(long adate, long bdate, long daycount, double *years)
+{
+    switch (daycount) {
+	case AKA_DAYS_ACT_360 :
+	    *years = (serial_day(bdate) - serial_day(adate)) / 360.0;
+	    return true;
+	case AKA_DAYS_ACT_365 :
+	    *years = (serial_day(bdate) - serial_day(adate)) / 365.0;
+	    return true;
+	default :
+	    return false;
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: AKAYears(adate, bdates[i], daycount) for n dates
+   Returns: nothing, years[i] is set for each date
+   ----------------------------------------------------------------- */
+inline void
+years_batch(long adate, const long *bdates, size_t n, long daycount,
+	    double *years)
+{
+    if (n == 0)
+	return;
+    size_t i = 0;
+    if (serial_years(adate, bdates[n - 1], daycount, &years[n - 1]) &&
+	years[n - 1] == AKAYears(adate, bdates[n - 1], daycount)) {
+	for (; i < n - 1; i++)
+	    serial_years(adate, bdates[i], daycount, &years[i]);
+	return;
+    }
+    for (; i < n; i++)
+	years[i] = AKAYears(adate, bdates[i], daycount);
+}
+
+#endif // ifndef _SERIALDATE_HPP_
@@ -0,0 +1,104 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A sinking fund bond prepared once for valuation at a pvdate.
+
+   Each valuation of a sinker walks its whole sink schedule: the sinks
+   already past reduce the outstanding amount, and a face amount is
+   checked against the schedule.  A bond valued many times at one
+   pvdate, for an OAS and its duration bumps or under many scenarios,
+   repeats that walk every call.  SinkState::Prepare() does it once.
+   The prepared bond holds only the sinks after the pvdate, with the
+   amount outstanding and held by accumulators stated, unless the
+   bond states neither a face nor an outstanding amount; the
+   allocation, delivery option and acceleration are unchanged.
+   Preparing again for the same bond, pvdate and status returns the
+   same prepared bond.
+
+   A bond without a sinking fund is returned as it is.
+   ------------------------------------------------------------------------- */
+#ifndef _SINKSTATE_HPP_
+#define _SINKSTATE_HPP_
+
+#include "akaapi.h"
+
+class SinkState {
+private:     // disallow copy, assignment
+    SinkState(const SinkState &);
+    SinkState & operator=(const SinkState &);
+
+    const AKABOND *source;
+    long pvdate;
+    double outstanding;
+    double accumulation;
+    AKABOND *prepared;
+
+    void Release() {
+	prepared = AKABondFree(prepared);
+	source = NULL;
+    };
+public:
+    SinkState()
+	: source(NULL), pvdate(0), outstanding(-1), accumulation(-1),
+	  prepared(NULL) {};
+    ~SinkState() { Release(); };
+
+	/* The bond to value at pvdate, owned here and valid until the
+	   next Prepare() for another bond, pvdate or status.
+	   outstanding and accumulation are in dollars, as in AKASINK;
+	   a negative amount keeps the bond's own.  An outstanding
+	   amount of zero there is the face less the sinks past, or
+	   without a face is left zero for the library to derive from
+	   the sinks to come.  Returns NULL if the bond could not be
+	   copied. */
+    const AKABOND *Prepare(long date, const AKABOND *bond,
+			   double os = -1, double ac = -1) {
+	if (bond->sink == NULL || bond->sink->n == 0)
+	    return bond;
+	if (prepared != NULL && source == bond && pvdate == date &&
+	    outstanding == os && accumulation == ac)
+	    return prepared;
+	Release();
+
+	const AKASINK *sink = bond->sink;
+	long first = 0;
+	double past = 0;
+	for (long i = 0; i < sink->n && sink->date[i] <= date; i++) {
+	    past += sink->amt[i];
+	    first = i + 1;
+	}
+
+	if ((prepared = AKABondCopy(bond)) == NULL)
+	    return NULL;
+	AKASINK *left = AKASinkAlloc(sink->n - first);
+	left->delivery = sink->delivery;
+	left->allocation = sink->allocation;
+	left->acceleration = sink->acceleration;
+	left->accumulation = (ac >= 0) ? ac : sink->accumulation;
+	if (os >= 0)
+	    left->outstanding = os;
+	else if (sink->outstanding > 0)
+	    left->outstanding = sink->outstanding;
+	else if (sink->face > 0)
+	    left->outstanding = sink->face - past;
+	else
+	    left->outstanding = 0;	/* derived from the sinks to come */
+	left->face = 0;		/* the schedule is now trusted */
+	for (long i = first; i < sink->n; i++) {
+	    left->date[i - first] = sink->date[i];
+	    left->amt[i - first] = sink->amt[i];
+	    left->px[i - first] = sink->px[i];
+	}
+	AKASinkFree(prepared->sink);
+	prepared->sink = left;
+
+	source = bond;
+	pvdate = date;
+	outstanding = os;
+	accumulation = ac;
+	return prepared;
+    };
+};
+
+#endif // ifndef _SINKSTATE_HPP_
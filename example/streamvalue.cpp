@@ -0,0 +1,459 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Streaming bond valuation over AKACalc data files.
+
+   The sorted bond, call, put, sink, and coupon files are merge-joined
+   on the issue key, so only the bonds in flight are held in memory.
+   The work is pipelined in three stages connected by bounded queues:
+
+     reader  -- one thread, parses and joins the input records
+     valuers -- -j threads, value the bonds and format output lines
+     writer  -- the main thread, writes the lines in input order
+
+   The number of records in flight is fixed by the queue size and the
+   number of valuers, so memory use is constant in the size of the
+   input files.  Every input bond record produces exactly one output
+   line, even if it fails to parse or value.
+
+   The bond file may instead be the binary form written by akacalc2bin,
+   which holds the option, sink, and coupon records as well.  It is
+   mapped into memory and needs no parsing, which takes the reader off
+   the critical path when there are many valuation threads.
+
+   With a holiday file, every bond is valued with its notification and
+   ex-coupon periods on that calendar, one HolidayCalendar shared by
+   all the bonds and threads (see holidaycal.hpp).  With -S the trade
+   date, from which call notice is counted, is that many business days
+   before the pvdate on the calendar, or on weekdays without one,
+   unless a price record gives its own.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "akacalc_binary.hpp"
+#include "holidaycal.hpp"
+#include "workqueue.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+
+/* one bond record as it moves through the pipeline */
+struct StreamItem {
+    BondSpec spec;
+    PriceRecord price;
+    bool priced;
+    std::string line;		/* formatted output */
+};
+
+/* settings shared read-only by all stages */
+struct StreamSetup {
+    long pvdate;
+    AKAHTREE tree;
+    bool have_prices;		/* a price file was given */
+    double oas;			/* quote when there is no price file */
+    int value_what;		/* AKABondVal3() flags */
+    const HolidayCalendar *calendar;	/* NULL for the bonds' own */
+    long tradedate;		/* 0 for none, see -S */
+};
+
+/* -----------------------------------------------------------------
+   Purpose: value one bond and format its output line
+   Returns: nothing, item->line is set and the bond is freed
+   ----------------------------------------------------------------- */
+static void
+value_item(const StreamSetup *setup, StreamItem *item)
+{
+    char buf[400];
+    const char *key = item->spec.key.c_str();
+    AKABOND *bond = item->spec.bond;
+
+    if (bond == NULL)
+	item->line = key + std::string(" ERROR ") + item->spec.error + "\n";
+    else if (setup->have_prices && !item->priced)
+	item->line = key + std::string(" ERROR no price on pvdate\n");
+    else {
+	long pvdate = setup->pvdate;
+	long tradedate = setup->tradedate;
+	long quotetype = AKA_QUOTE_OAS;
+	double quote = setup->oas;
+	if (item->priced) {
+	    quotetype = AKA_QUOTE_PRICE;
+	    quote = item->price.price;
+	    if (item->price.tradedate != 0)
+		tradedate = item->price.tradedate;
+	    if (item->price.outstanding >= 0 && bond->sink != NULL &&
+		bond->sink->n > 0)
+		bond->sink->outstanding = item->price.outstanding;
+	}
+	    /* the holidays from the trade date on, before the dates are
+	       packed into a number which is no date */
+	if (setup->calendar != NULL)
+	    setup->calendar->Apply(bond, tradedate ? tradedate : pvdate);
+	if (tradedate != 0)
+	    pvdate = AKADatePack(pvdate, tradedate);
+	AKABONDREPORT rpt;
+	memset(&rpt, 0, sizeof(rpt));
+	AKABondVal3(pvdate, quotetype, quote, setup->tree, bond, &rpt, NULL,
+		    setup->value_what);
+	enum AKA_ERROR_NUMBER error = AKAError();
+	if (error != AKA_ERROR_NONE)
+	    snprintf(buf, sizeof(buf), " ERROR %s\n", AKAErrorString(error));
+	else if (setup->value_what == 0)
+	    snprintf(buf, sizeof(buf), " %.6f %.4f %.6f\n",
+		     rpt.price, rpt.oas, rpt.accrued);
+	else
+	    snprintf(buf, sizeof(buf),
+		     " %.6f %.4f %.6f %.6f %.4f %.4f %.4f %.4f %.4f %.4f\n",
+		     rpt.price, rpt.oas, rpt.accrued, rpt.optval,
+		     rpt.effDur, rpt.effCon, rpt.ytm, rpt.ytc, rpt.ytp,
+		     rpt.modDur);
+	item->line = key + std::string(buf);
+    }
+    AKABondFree(bond);
+    item->spec.bond = NULL;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *couponfile = NULL;
+    const char *pricefile = NULL;
+    const char *holidayfile = NULL;
+    int nthreads = (int) std::thread::hardware_concurrency();
+    int qsize = 256;
+    int settledays = 0;
+    bool timing = false;
+    bool quiet = false;
+    StreamSetup setup;
+    setup.oas = 0;
+    setup.value_what = 0;
+    setup.have_prices = false;
+    setup.calendar = NULL;
+    setup.tradedate = 0;
+
+    while((c = getopt(argc, argv, "a:c:C:fj:o:P:q:S:tz"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'c' :
+		holidayfile = optarg;
+		break;
+	    case 'C' :
+		couponfile = optarg;
+		break;
+	    case 'f' :
+		setup.value_what = AKABONDVAL_DURATION | AKABONDVAL_OPTION |
+		    AKABONDVAL_YIELDS;
+		break;
+	    case 'j' :
+		nthreads = atoi(optarg);
+		break;
+	    case 'o' :
+		setup.oas = atof(optarg);
+		break;
+	    case 'P' :
+		pricefile = optarg;
+		break;
+	    case 'q' :
+		qsize = atoi(optarg);
+		break;
+	    case 'S' :
+		settledays = atoi(optarg);
+		break;
+	    case 't' :
+		timing = true;
+		break;
+	    case 'z' :
+		quiet = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 3) {
+	usage();
+	return 1;
+    }
+    if (nthreads < 1)
+	nthreads = 1;
+    if (qsize < 1)
+	qsize = 1;
+
+    setup.pvdate = akadatecnv(argv[0]);
+    const char *yieldfile = argv[1];
+    const char *bondfile = argv[2];
+    const char *callfile = argc > 3 ? argv[3] : NULL;
+    const char *putfile = argc > 4 ? argv[4] : NULL;
+    const char *sinkfile = argc > 5 ? argv[5] : NULL;
+
+    init(keyfile);
+
+    std::string error;
+    AKACURVE *curve = read_yield_curve(yieldfile, setup.pvdate, error);
+    if (curve == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    setup.tree = AKATreeFit(curve, NULL);
+    AKACurveFree(curve);
+    if (setup.tree == 0) {
+	fprintf(stderr, "Error: tree fit failed: %s\n",
+		AKAErrorString(AKAError()));
+	return 1;
+    }
+
+    BondSpecReader textspecs;
+    BinaryBondFile binspecs;
+    BondSource *specs = open_bond_source(bondfile, callfile, putfile,
+					 sinkfile, couponfile, textspecs,
+					 binspecs, error);
+    if (specs == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    PriceReader prices;
+    if (pricefile != NULL) {
+	if (!prices.Open(pricefile, setup.pvdate)) {
+	    fprintf(stderr, "Error: unable to open %s\n", pricefile);
+	    return 1;
+	}
+	setup.have_prices = true;
+    }
+    std::shared_ptr<HolidayCalendar> calendar;
+    if (holidayfile != NULL) {
+	calendar = HolidayCalendar::Load(holidayfile, holidayfile, error);
+	if (calendar == NULL) {
+	    fprintf(stderr, "Error: %s\n", error.c_str());
+	    return 1;
+	}
+	setup.calendar = calendar.get();
+	if (!calendar->IsBusinessDay(setup.pvdate))
+	    fprintf(stderr, "Warning: the pvdate is not a business day of "
+		    "%s\n", holidayfile);
+    }
+    if (settledays > 0) {
+	if (calendar == NULL)	/* weekends only */
+	    calendar = std::make_shared<HolidayCalendar>(
+		"weekdays", (const long *) NULL, (size_t) 0);
+	setup.tradedate = calendar->AddBusinessDays(setup.pvdate,
+						    -settledays);
+    }
+
+    clock_t start = clock();
+    time_t wallstart = time(NULL);
+
+    PriceReader *priced = setup.have_prices ? &prices : NULL;
+    long written = run_pipeline<StreamItem>(nthreads, qsize,
+	[&](StreamItem &item) {
+	    if (!specs->Next(item.spec))
+		return false;
+	    item.priced = priced != NULL &&
+		priced->Find(item.spec.key, item.price);
+	    return true;
+	},
+	[&](StreamItem &item, int) { value_item(&setup, &item); },
+	[&](StreamItem &item) {
+	    if (!quiet)
+		fputs(item.line.c_str(), stdout);
+	});
+
+    if (specs->Orphans() > 0)
+	fprintf(stderr, "Warning: %ld option, sink, or coupon records "
+		"without a bond record\n", specs->Orphans());
+    if (timing)
+	fprintf(stderr, "%ld bonds, %d valuation threads, "
+		"cpu seconds = %0.2f, elapsed seconds = %ld\n",
+		written, nthreads, INSECS(clock() - start),
+		(long) (time(NULL) - wallstart));
+
+    AKATreeRelease(setup.tree);
+    specs->Release();
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: value the bonds of AKACalc data files, streaming\n");
+    printf("Usage: [FLAGS] <pvdate> <yield-file> <bond-file> "
+	   "[<call-file> [<put-file> [<sink-file>]]]\n");
+    printf("Use - in place of an unused call or put file name.\n");
+    printf("The bond file may be a binary file from akacalc2bin, "
+	   "without other files.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-c <holiday-file> -- notification holidays, yyyymmdd per line\n"
+	"\t-C <coupon-file> -- step up/down coupon file\n"
+	"\t-f -- full valuation, add option value, durations, and yields\n"
+	"\t-j <cnt> -- number of valuation threads, default one per core\n");
+    printf(
+	"\t-o <oas> -- value at oas when there is no price file, default 0\n"
+	"\t-P <price-file> -- value at the prices for the pvdate\n"
+	"\t-q <cnt> -- records queued between stages, default 256\n"
+	"\t-S <days> -- trade the business days before the pvdate, "
+	"for call notice\n"
+	"\t-t -- display timings on stderr\n"
+	"\t-z -- silent mode, no output, for timing\n");
+    printf(
+	"\nOutput, one line per bond record, in input order:\n"
+	"\tkey price oas accrued\n"
+	"\tkey price oas accrued optval effdur effcon ytm ytc ytp moddur "
+	"(-f)\n"
+	"\tkey ERROR message\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
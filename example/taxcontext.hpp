@@ -0,0 +1,101 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   A tax bracket passed to each after-tax call rather than set on the
+   library or the bond.
+
+   AKADefaultTaxRate() is global, and AKABondTaxRate() changes the
+   bond, so valuing one bond for clients in different brackets at the
+   same time takes a copy of the bond per bracket.  The after-tax
+   reports carry their own tax inputs, which take the place of the
+   bond's and the default.  A TaxContext holds a bracket and fills
+   those inputs on every call it makes, so any number of contexts may
+   value the same shared, unchanged bond on any number of threads,
+   with no copy and no lock.  A context is a few doubles; it is only
+   read by its calls and may itself be shared.
+
+   As in the reports, a field of zero takes the bond's setting.
+   ------------------------------------------------------------------------- */
+#ifndef _TAXCONTEXT_HPP_
+#define _TAXCONTEXT_HPP_
+
+#include <string.h>
+
+#include "akaapi.h"
+
+class TaxContext {
+public:
+    double income;		/* 35.0 = 35% */
+    double capgain_short;
+    double capgain_long;
+    double capgain_superlong;	/* > 5yrs, issued since 1/1/01 */
+    double issue_price;		/* 100 is par, 0 takes the bond's */
+
+	// the library's defaults unless given
+    TaxContext(double inc = 35, double cgshort = 35, double cglong = 15,
+	       double cgsuperlong = 15, double issue = 0)
+	: income(inc), capgain_short(cgshort), capgain_long(cglong),
+	  capgain_superlong(cgsuperlong), issue_price(issue) {};
+
+	// the bracket in effect for a bond, see AKABondTaxRateGet()
+    static TaxContext OfBond(const AKABOND *bond) {
+	TaxContext tax;
+	AKABondTaxRateGet(const_cast<AKABOND *>(bond), &tax.income,
+			  &tax.capgain_short, &tax.capgain_long,
+			  &tax.capgain_superlong);
+	return tax;
+    };
+
+    bool operator==(const TaxContext &o) const {
+	return income == o.income && capgain_short == o.capgain_short &&
+	    capgain_long == o.capgain_long &&
+	    capgain_superlong == o.capgain_superlong &&
+	    issue_price == o.issue_price;
+    };
+    bool operator!=(const TaxContext &o) const { return !(*this == o); };
+
+	// fill the input fields of an AKAATAXYLD or AKAATAXBASIS
+    template <class Report> void Stamp(Report *rpt) const {
+	rpt->issue_price = issue_price;
+	rpt->taxrate_short = capgain_short;
+	rpt->taxrate_long = capgain_long;
+	rpt->taxrate_superlong = capgain_superlong;
+	rpt->taxrate_income = income;
+    };
+
+	/* AKAAtaxYield() in this bracket: pvdate is the purchase date
+	   and quote the purchase price */
+    long Yield(long pvdate, long quotetype, double quote,
+	       const AKABOND *bond, AKAATAXYLD *rpt) const {
+	memset(rpt, 0, sizeof(*rpt));
+	Stamp(rpt);
+	return AKAAtaxYield(pvdate, quotetype, quote, bond, rpt);
+    };
+
+	/* AKAAtaxBasis() in this bracket: saledate and quote are the
+	   sale, purchase_date and purchase_price the purchase */
+    long Basis(long saledate, long quotetype, double quote,
+	       long purchase_date, double purchase_price,
+	       const AKABOND *bond, AKAATAXBASIS *rpt) const {
+	memset(rpt, 0, sizeof(*rpt));
+	Stamp(rpt);
+	rpt->purchase_date = purchase_date;
+	rpt->purchase_price = purchase_price;
+	return AKAAtaxBasis(saledate, quotetype, quote, bond, rpt);
+    };
+
+	// AKABondScen4() after tax in this bracket
+    long Scenario(long quotetype, double quote, const AKASCEN *scen,
+		  const AKABOND *bond, AKASCENREPORT *rpt,
+		  double eff_threshold, double *efficiency,
+		  double reinvest) const {
+	AKAATAXYLD info;
+	memset(&info, 0, sizeof(info));
+	Stamp(&info);
+	return AKABondScen4(quotetype, quote, scen, bond, rpt, eff_threshold,
+			    efficiency, reinvest, &info);
+    };
+};
+
+#endif // ifndef _TAXCONTEXT_HPP_
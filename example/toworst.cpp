@@ -0,0 +1,398 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Yields to worst of the bonds of AKACalc data files, at their prices
+   for the pvdate, by the shared solve of toworst.hpp.
+
+   Each bond's flows and year fractions are prepared once, and the worst
+   yield is found by one solve across its exercise dates; with -f the
+   yield to every date is solved, as in AKAYieldToWorstEx2().  Bonds
+   the flows cannot value, sinkers and bonds of other yield methods,
+   are passed to the library.  -l takes every bond to the library, to
+   time the two, and -v compares the worst yield and date with the
+   library's, or with -f the yield and date of every entry.
+
+   With -r each bond gets the whole to worst report of to_worst(): its
+   yield to maturity, worst yield and date, modified duration and
+   convexity to that date, and lowest price at the yield to maturity
+   and its date, from one list of dates, in place of the library's
+   AKABondValueYieldsEx() and AKAPriceToWorst().  -v then compares
+   every field of the report with the library's.
+
+   see usage() below
+   ------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef _MSC_VER  /* include implementation of getopts -- see end of file */
+const char *optarg = NULL;
+int optind = 0;
+int getopt(int, char *const *, const char *);
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+#include "akaapi.h"
+#include "akacalc_files.hpp"
+#include "akacalc_binary.hpp"
+#include "toworst.hpp"
+
+/* forward declarations */
+void usage();
+void init(const char *);
+long akadatecnv(const char *date);
+
+#define INSECS(x) ((double) (x) / CLOCKS_PER_SEC)
+
+/* -----------------------------------------------------------------
+   Purpose: start here
+   Returns:
+   ----------------------------------------------------------------- */
+int
+main(int argc, char *argv[])
+{
+    int c;
+    const char *keyfile = NULL;
+    const char *couponfile = NULL;
+    bool all = false;
+    bool report = false;
+    bool library = false;
+    bool timing = false;
+    bool verify = false;
+    bool quiet = false;
+
+    while((c = getopt(argc, argv, "a:C:flrtvz"))!= EOF) {
+	switch(c) {
+	    case 'a' :
+		keyfile = optarg;
+		break;
+	    case 'C' :
+		couponfile = optarg;
+		break;
+	    case 'f' :
+		all = true;
+		break;
+	    case 'l' :
+		library = true;
+		break;
+	    case 'r' :
+		report = true;
+		break;
+	    case 't' :
+		timing = true;
+		break;
+	    case 'v' :
+		verify = true;
+		break;
+	    case 'z' :
+		quiet = true;
+		break;
+	    default :
+		usage();
+		return 0;
+	}
+    }
+    argc -= optind;
+    argv += optind;
+    if (argc < 3) {
+	usage();
+	return 1;
+    }
+
+    long pvdate = akadatecnv(argv[0]);
+    const char *pricefile = argv[1];
+    const char *bondfile = argv[2];
+    const char *callfile = argc > 3 ? argv[3] : NULL;
+    const char *putfile = argc > 4 ? argv[4] : NULL;
+    const char *sinkfile = argc > 5 ? argv[5] : NULL;
+
+    init(keyfile);
+
+    BondSpecReader textspecs;
+    BinaryBondFile binspecs;
+    std::string error;
+    BondSource *specs = open_bond_source(bondfile, callfile, putfile,
+					 sinkfile, couponfile, textspecs,
+					 binspecs, error);
+    if (specs == NULL) {
+	fprintf(stderr, "Error: %s\n", error.c_str());
+	return 1;
+    }
+    PriceReader prices;
+    if (!prices.Open(pricefile, pvdate)) {
+	fprintf(stderr, "Error: unable to open %s\n", pricefile);
+	return 1;
+    }
+
+    clock_t start = clock();
+    long nbonds = 0, nlibrary = 0, failed = 0, mismatched = 0;
+    double maxdiff = 0, maxpdiff = 0, maxmdiff = 0, maxddiff = 0;
+    double maxcdiff = 0;
+    FlowYears fy;
+    BondSpec spec;
+    ToWorstYields rpt, check;
+    ToWorstReport worst, wcheck;
+    while (specs->Next(spec)) {
+	const char *key = spec.key.c_str();
+	PriceRecord price;
+	nbonds++;
+	if (spec.bond == NULL) {
+	    if (!quiet)
+		printf("%s ERROR %s\n", key, spec.error.c_str());
+	    failed++;
+	    continue;
+	}
+	if (!prices.Find(spec.key, price)) {
+	    if (!quiet)
+		printf("%s ERROR no price on pvdate\n", key);
+	    failed++;
+	}
+	else if (report) {
+	    if (!(library ? to_worst_library(pvdate, price.price, spec.bond,
+					     worst) :
+		  to_worst(pvdate, price.price, spec.bond, fy, worst))) {
+		if (!quiet)
+		    printf("%s ERROR %s\n", key,
+			   AKAError() != AKA_ERROR_NONE ?
+			   AKAErrorString(AKAError()) :
+			   "yield did not settle");
+		failed++;
+	    }
+	    else {
+		if (worst.library)
+		    nlibrary++;
+		if (!quiet)
+		    printf("%s %.6f %.6f %ld %.6f %ld %.6f %.6f\n", key,
+			   worst.ytm, worst.ytw, worst.ytwdate, worst.ptw,
+			   worst.ptwdate, worst.modDurWorst,
+			   worst.modConWorst);
+		    /* every field of the report */
+		if (verify && !worst.library &&
+		    to_worst_library(pvdate, price.price, spec.bond, wcheck)) {
+		    if (wcheck.ytwdate != worst.ytwdate ||
+			wcheck.ptwdate != worst.ptwdate)
+			mismatched++;
+		    maxmdiff = std::max(maxmdiff,
+					fabs(wcheck.ytm - worst.ytm));
+		    maxdiff = std::max(maxdiff, fabs(wcheck.ytw - worst.ytw));
+		    maxddiff = std::max(maxddiff, fabs(wcheck.modDurWorst -
+						       worst.modDurWorst));
+		    maxcdiff = std::max(maxcdiff, fabs(wcheck.modConWorst -
+						       worst.modConWorst));
+		    maxpdiff = std::max(maxpdiff,
+					fabs(wcheck.ptw - worst.ptw));
+		}
+	    }
+	}
+	else if (!(library ?
+		   toworst_library(pvdate, price.price, spec.bond, all, rpt) :
+		   yield_to_worst(pvdate, price.price, spec.bond, all, fy,
+				  rpt))) {
+	    if (!quiet)
+		printf("%s ERROR %s\n", key, AKAError() != AKA_ERROR_NONE ?
+		       AKAErrorString(AKAError()) : "yield did not settle");
+	    failed++;
+	}
+	else {
+	    if (rpt.library)
+		nlibrary++;
+	    if (!quiet) {
+		printf("%s %.6f %ld", key, rpt.yields[rpt.worst],
+		       rpt.dates[rpt.worst]);
+		if (all)
+		    for (size_t i = 0; i < rpt.dates.size(); i++)
+			printf(" %ld:%.6f", rpt.dates[i], rpt.yields[i]);
+		printf("\n");
+	    }
+	    if (verify && !rpt.library &&
+		toworst_library(pvdate, price.price, spec.bond, all,
+				check)) {
+		    /* every date and yield of the list, with -f */
+		if (check.dates != rpt.dates || check.worst != rpt.worst)
+		    mismatched++;
+		else
+		    for (size_t i = 0; i < rpt.yields.size(); i++)
+			maxdiff = std::max(maxdiff, fabs(check.yields[i] -
+							 rpt.yields[i]));
+	    }
+	}
+	fy.Reset();		/* the bond is freed, its address reused */
+	AKABondFree(spec.bond);
+	spec.bond = NULL;
+    }
+
+    if (specs->Orphans() > 0)
+	fprintf(stderr, "Warning: %ld option, sink, or coupon records "
+		"without a bond record\n", specs->Orphans());
+    if (verify && report)
+	fprintf(stderr, "largest differences from AKABondValueYieldsEx(): "
+		"ytm %g, ytw %g, moddur %g, modcon %g; from "
+		"AKAPriceToWorst(): ptw %g; %ld bonds with other dates\n",
+		maxmdiff, maxdiff, maxddiff, maxcdiff, maxpdiff, mismatched);
+    else if (verify)
+	fprintf(stderr, "largest difference from AKAYieldToWorstEx2() = %g, "
+		"%ld bonds with other dates\n", maxdiff, mismatched);
+    if (timing)
+	fprintf(stderr, "%ld bonds, %ld by the library, %ld failed, "
+		"cpu seconds = %0.2f\n", nbonds, nlibrary, failed,
+		INSECS(clock() - start));
+
+    specs->Release();
+    AKA_shutdown();
+    return 0;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: display usage message
+   Returns: nothing
+   ----------------------------------------------------------------- */
+void
+usage()
+{
+    printf("Purpose: yields to worst of the bonds of AKACalc data files\n");
+    printf("Usage: [FLAGS] <pvdate> <price-file> <bond-file> "
+	   "[<call-file> [<put-file> [<sink-file>]]]\n");
+    printf("Use - in place of an unused call or put file name.\n");
+    printf("The bond file may be a binary file from akacalc2bin, "
+	   "without other files.\n");
+    printf(
+	"\nFlags:\n"
+	"\t-a key-file -- load akalib key from file, default ./akalib.key\n"
+	"\t-C <coupon-file> -- step up/down coupon file\n"
+	"\t-f -- solve the yield to every date, and list them\n"
+	"\t-l -- take every bond to the library, for timing\n"
+	"\t-r -- report yield and price to worst, with duration and "
+	"convexity\n");
+    printf(
+	"\t-t -- display timings on stderr\n"
+	"\t-v -- verify against the library, on stderr\n"
+	"\t-z -- silent mode, no output, for timing\n");
+    printf(
+	"\nOutput, one line per bond record, in input order:\n"
+	"\tkey ytw worst-date\n"
+	"\tkey ytw worst-date date:yield... (-f)\n"
+	"\tkey ytm ytw ytw-date ptw ptw-date moddur modcon (-r)\n"
+	"\tkey ERROR message\n");
+    printf("AKA library version: %.2f\n", AKA_version());
+}
+
+/* -----------------------------------------------------------------
+   Purpose: try and get the key from a file
+   Returns: nothing -- all errors exit
+   ----------------------------------------------------------------- */
+void
+readkey(const char *fname, long *key, char *uname, int namesize)
+{
+    FILE *fp;
+    char linestr[200];
+
+    *key = 0;
+    memset(uname, 0, namesize);
+
+    fp = fopen(fname, "r");
+    if (fp == NULL) {
+	fprintf(stderr, "Error: unable to open akakey file %s\n", fname);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL ||
+	     (*key = atol(linestr)) == 0) {
+	fprintf(stderr, "Error: missing key line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else if (fgets(linestr, sizeof(linestr), fp) == NULL) {
+	fprintf(stderr, "Error: missing user name line from akakey file %s\n",
+		fname);
+	fclose(fp);
+	exit(1);
+    }
+    else {
+	fclose(fp);
+	strncpy(uname, linestr, namesize - 1);
+	for (namesize-- ; namesize > 0; namesize--) {
+	    if (uname[namesize] != '\0') {
+		if (isspace((int) uname[namesize]))
+		    uname[namesize] = '\0';
+		else
+		    break;
+	    }
+	}
+    }
+}
+
+/*-----------------------------------------------------------------
+  Purpose: init what need to run
+  -----------------------------------------------------------------*/
+void
+init(const char *keyfile)
+{
+    long key;
+    char uname[100];
+
+    if (keyfile == NULL)
+	keyfile = "akalib.key";
+
+    readkey(keyfile, &key, uname, sizeof(uname));
+    if (AKA_initialize(key, uname) != 0) {
+	fprintf(stderr, "Error: library initialization failed\n");
+	exit(1);
+    }
+}
+
+/* -----------------------------------------------------------------
+   Purpose: make an aka date from the standard mm/dd/yyyy format
+   Returns: AKADATE
+   ----------------------------------------------------------------- */
+long
+akadatecnv(const char *date)
+{
+    int m, d, y;
+    if (sscanf(date, "%d/%d/%d", &m, &d, &y) != 3)
+	return atol(date);	/* assume is in AKA yyyymmdd format */
+    else {
+	if (y < 1900)
+	    y += 1900;
+	return y * 10000 + m * 100 + d;
+    }
+}
+
+#ifdef _MSC_VER
+/* -----------------------------------------------------------------
+   Purpose: extremely simplified version of getopt for microsoft
+   Returns:
+   ----------------------------------------------------------------- */
+int
+getopt (int argc, char *const *argv, const char *opts)
+{
+    int c = EOF;
+    optind += 1;
+    optarg = NULL;
+    if (optind < argc && argv[optind][0] == '-') {
+	const char *opt = NULL;
+	c = argv[optind][1];
+	opt = strchr(opts, c);
+	if (opt) {
+	    if (opt[1] == ':') {
+		if (optind < argc -1) {
+		    optind++;
+		    optarg = argv[optind];
+		}
+		else
+		    c = '?';
+	    }
+	}
+	else
+	    c = '?';
+    }
+    return c;
+}
+
+#endif
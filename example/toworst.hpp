@@ -0,0 +1,435 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Yields to worst from one root-find shared by all the exercise dates.
+
+   AKAYieldToWorstEx() solves a yield to each call, put and maturity
+   date, each solve on its own.  A muni callable on every coupon date
+   takes dozens of them.  Here the dates come from the bond's option
+   schedules as in that report: each European date, and for an
+   American option its schedule dates and every flow date after the
+   first, at the price in effect, and the maturity.  The flows and year
+   fractions are those of a FlowYears (see flowyears.hpp), prepared
+   once.
+
+   toworst_yield() finds only the worst.  The value of the bond to a
+   date falls as the yield rises, so the worst yield is the root of
+   the lowest of those values.  One Newton solve, kept to a bracket,
+   finds it: each step discounts the flows once, and the values to all
+   the dates are running sums of the discounted flows.  Flow dates
+   inside a run of flow dates of one option at one price are dropped
+   first; the yield to such dates moves one way with the date, so the
+   worst of a run is at one of its ends, as long as the coupon is
+   level.  A bond with a coupon schedule keeps every date, as do
+   dates between flows, with their accrued interest.
+
+   toworst_yields() fills the yield to every date, as the library's
+   report does, each solve started from the yield to the date before.
+
+   yield_to_worst() does either for a bond, and passes a bond with a
+   sinking fund or a yield method other than bond equivalent to
+   AKAYieldToWorstEx2().
+
+   to_worst() fills a ToWorstReport, what AKABondValueYieldsEx(),
+   AKAYieldToWorst() and AKAPriceToWorst() give between them, from one
+   list of dates: the yield to maturity, the worst yield and its date,
+   the modified duration and convexity to that date, and the lowest
+   price at the yield to maturity, with one discounting pass at that
+   yield for all the dates.
+   ------------------------------------------------------------------------- */
+#ifndef _TOWORST_HPP_
+#define _TOWORST_HPP_
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "akaapi.h"
+#include "flowyears.hpp"
+
+enum ToWorstKind {
+    TOWORST_CALL,
+    TOWORST_PUT,
+    TOWORST_MATURITY
+};
+
+/* a date the bond may be redeemed on */
+struct ToWorstDate {
+    long date;
+    double price;		/* < 0 at maturity, the scheduled flows */
+    int kind;			/* select from ToWorstKind */
+    FlowRedemption redemption;	/* filled by toworst_dates() */
+};
+
+/* the yields to worst of a bond */
+struct ToWorstYields {
+    std::vector<long> dates;
+    std::vector<double> yields;	/* all dates, or only the worst */
+    int worst;			/* index of the worst */
+    bool library;		/* from AKAYieldToWorstEx2() */
+};
+
+/* yield and price to worst of a bond, as the library reports them */
+struct ToWorstReport {
+    double ytm;
+    double ytw;
+    long ytwdate;
+    double modDurWorst;		/* to the ytw date at the ytw */
+    double modConWorst;
+    double ptw;			/* lowest clean price at the ytm */
+    long ptwdate;
+    bool library;		/* from AKABondValueYieldsEx() and
+				   AKAPriceToWorst() */
+};
+
+/* -----------------------------------------------------------------
+   Purpose: can the yields of the bond be taken from its flows
+   Returns: false for a sinking fund or a yield method other than
+	    bond equivalent
+   ----------------------------------------------------------------- */
+inline bool
+toworst_supported(const AKABOND *bond)
+{
+    long method = bond->sec->yld_method;
+    return (bond->sink == NULL || bond->sink->n == 0) &&
+	(method == AKA_YLD_GLOBAL || method == AKA_YLD_BEY);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: add the exercise dates of an option after the pvdate and
+	    before maturity
+   Returns: nothing
+   ----------------------------------------------------------------- */
+inline void
+toworst_option_dates(const FlowYears &fy, const AKAOPTION *opt, int kind,
+		     long mdate, std::vector<ToWorstDate> &dates)
+{
+    if (opt == NULL || opt->n == 0)
+	return;
+    ToWorstDate d;
+    d.kind = kind;
+    for (long i = 0; i < opt->n; i++) {
+	d.date = opt->date[i];
+	d.price = opt->px[i];
+	if (d.date > fy.Pvdate() && d.date < mdate)
+	    dates.push_back(d);
+    }
+    if (opt->type != AKA_OPTION_AMERICAN)
+	return;
+    long j = 0;
+    for (size_t i = 0; i < fy.Size(); i++) {
+	d.date = fy.Date(i);
+	if (d.date < opt->date[0] || d.date >= mdate)
+	    continue;
+	while (j + 1 < opt->n && opt->date[j + 1] <= d.date)
+	    j++;
+	d.price = opt->px[j];
+	if (opt->date[j] != d.date)
+	    dates.push_back(d);
+    }
+}
+
+inline bool
+toworst_date_less(const ToWorstDate &a, const ToWorstDate &b)
+{
+    if (a.date != b.date)
+	return a.date < b.date;
+    return a.kind < b.kind;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the dates the prepared bond may be redeemed on, in date
+	    order, with their redemptions
+   Returns: nothing
+   ----------------------------------------------------------------- */
+inline void
+toworst_dates(const FlowYears &fy, std::vector<ToWorstDate> &dates)
+{
+    const AKABOND *bond = fy.Bond();
+    long mdate = bond->sec->mdate;
+    dates.clear();
+    toworst_option_dates(fy, bond->call, TOWORST_CALL, mdate, dates);
+    toworst_option_dates(fy, bond->put, TOWORST_PUT, mdate, dates);
+    std::stable_sort(dates.begin(), dates.end(), toworst_date_less);
+    ToWorstDate m;
+    m.date = mdate;
+    m.price = -1;
+    m.kind = TOWORST_MATURITY;
+    dates.push_back(m);
+    for (size_t i = 0; i < dates.size(); i++)
+	dates[i].redemption = flow_redemption(fy, dates[i].date,
+					      dates[i].price);
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the yield to every date at a clean price, each solve
+	    started from the yield to the date before
+   Returns: index of the worst, -1 if a yield did not settle
+   ----------------------------------------------------------------- */
+inline int
+toworst_yields(const FlowYears &fy, const std::vector<ToWorstDate> &dates,
+	       double price, std::vector<double> &yields)
+{
+    int worst = -1;
+    double guess = fy.Bond()->sec->coupon;
+    yields.resize(dates.size());
+    for (size_t k = 0; k < dates.size(); k++) {
+	double y = flow_yield(fy, dates[k].redemption, price, guess);
+	if (y == FLOW_YIELD_ERROR)
+	    return -1;
+	yields[k] = guess = y;
+	if (worst < 0 || y < yields[worst])
+	    worst = (int) k;
+    }
+    return worst;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the lowest value to the kept dates at a yield, and its
+	    slope in the yield
+   Returns: the index of the date of the lowest value
+   ----------------------------------------------------------------- */
+inline size_t
+toworst_lowest(const FlowYears &fy, const std::vector<ToWorstDate> &dates,
+	       const std::vector<size_t> &kept, double yield,
+	       std::vector<double> &sums, std::vector<double> &slopes,
+	       double *value, double *slope)
+{
+    double f = (double) fy.Frequency();
+    double base = 1 + yield / (100 * f);
+    double lnbase = log(base);
+
+	/* running sums of the discounted flows, and of their slopes */
+    sums.resize(fy.Size() + 1);
+    slopes.resize(fy.Size() + 1);
+    sums[0] = slopes[0] = 0;
+    for (size_t i = 0; i < fy.Size(); i++) {
+	double n = f * fy.Years(i);
+	double pv = fy.Flow(i) * exp(-n * lnbase);
+	sums[i + 1] = sums[i] + pv;
+	slopes[i + 1] = slopes[i] - pv * n / (100 * f * base);
+    }
+
+    size_t lowest = kept[0];
+    for (size_t j = 0; j < kept.size(); j++) {
+	const FlowRedemption &r = dates[kept[j]].redemption;
+	double n = f * r.t;
+	double pv = r.payment * exp(-n * lnbase);
+	double v = sums[r.through] + pv;
+	if (j == 0 || v < *value) {
+	    *value = v;
+	    *slope = slopes[r.through] - pv * n / (100 * f * base);
+	    lowest = kept[j];
+	}
+    }
+    return lowest;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the worst yield at a clean price by one shared solve
+   Returns: the yield, FLOW_YIELD_ERROR if it did not settle; *worst
+	    is the index of its date
+   ----------------------------------------------------------------- */
+inline double
+toworst_yield(const FlowYears &fy, const std::vector<ToWorstDate> &dates,
+	      double price, int *worst)
+{
+	/* the ends of each run of flow dates of an option at one price,
+	   every date if the coupon steps */
+    const AKABOND *bond = fy.Bond();
+    bool level = bond->cpn == NULL || bond->cpn->n == 0;
+    std::vector<size_t> kept, run;
+    for (size_t k = 0; k < dates.size(); k++) {
+	const FlowRedemption &r = dates[k].redemption;
+	bool flowdate = level && dates[k].kind != TOWORST_MATURITY &&
+	    r.through > 0 && fy.Date(r.through - 1) == dates[k].date;
+	if (!flowdate)
+	    kept.push_back(k);
+	else
+	    run.push_back(k);
+    }
+    for (size_t j = 0; j < run.size(); j++) {
+	const ToWorstDate &d = dates[run[j]];
+	size_t prev = j, next = j;
+	while (prev > 0 && dates[run[--prev]].kind != d.kind)
+	    ;
+	while (next + 1 < run.size() && dates[run[++next]].kind != d.kind)
+	    ;
+	bool inside = prev != j && dates[run[prev]].kind == d.kind &&
+	    dates[run[prev]].price == d.price &&
+	    next != j && dates[run[next]].kind == d.kind &&
+	    dates[run[next]].price == d.price;
+	if (!inside)
+	    kept.push_back(run[j]);
+    }
+    std::sort(kept.begin(), kept.end());
+
+    double target = price + fy.Accrued();
+    double f = (double) fy.Frequency();
+    double lo = -100 * f, hi = HUGE_VAL;
+    double yield = bond->sec->coupon;
+    std::vector<double> sums, slopes;
+    for (int step = 0; step < 2 * FLOW_YIELD_MAXSTEPS; step++) {
+	double value = 0, slope = 0;
+	size_t k = toworst_lowest(fy, dates, kept, yield, sums, slopes,
+				  &value, &slope);
+	if (fabs(value - target) <= 1e-10 * target) {
+	    *worst = (int) k;
+	    return yield;
+	}
+	if (value > target)
+	    lo = yield;
+	else
+	    hi = yield;
+	double next = slope < 0 ? yield - (value - target) / slope : hi;
+	if (!(next > lo && next < hi))	/* outside the bracket, halve it */
+	    next = hi == HUGE_VAL ? 2 * fabs(yield) + 1 : (lo + hi) / 2;
+	yield = next;
+    }
+    return FLOW_YIELD_ERROR;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the yields to worst of AKAYieldToWorstEx2(), of every date
+	    with all, or only the worst
+   Returns: false on a library error
+   ----------------------------------------------------------------- */
+inline bool
+toworst_library(long pvdate, double price, const AKABOND *bond, bool all,
+		ToWorstYields &rpt)
+{
+    rpt.dates.clear();
+    rpt.yields.clear();
+    rpt.worst = -1;
+    rpt.library = true;
+    AKAYLDWORST *w = AKAYieldToWorstEx2(pvdate, AKA_QUOTE_PRICE, price,
+					bond, 0, 0);
+    if (w == NULL || w->n == 0) {
+	AKAYldWorstReportFree(w);
+	return false;
+    }
+    for (int i = 0; i < w->n; i++)
+	if (all || i == w->worst) {
+	    rpt.dates.push_back(w->dates[i]);
+	    rpt.yields.push_back(w->yields[i]);
+	}
+    rpt.worst = all ? w->worst : 0;
+    AKAYldWorstReportFree(w);
+    return true;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the yields to worst of a bond at a clean price, the yield
+	    to every date with all, or only the worst.  fy is prepared
+	    for the bond here.
+   Returns: false on an error, see AKAError() if it is the library's
+   ----------------------------------------------------------------- */
+inline bool
+yield_to_worst(long pvdate, double price, const AKABOND *bond, bool all,
+	       FlowYears &fy, ToWorstYields &rpt)
+{
+    if (!toworst_supported(bond))
+	return toworst_library(pvdate, price, bond, all, rpt);
+    rpt.dates.clear();
+    rpt.yields.clear();
+    rpt.worst = -1;
+    rpt.library = false;
+
+    std::vector<ToWorstDate> dates;
+    if (!fy.Prepare(pvdate, bond))
+	return false;
+    toworst_dates(fy, dates);
+    if (all) {
+	if ((rpt.worst = toworst_yields(fy, dates, price, rpt.yields)) < 0)
+	    return false;
+	for (size_t k = 0; k < dates.size(); k++)
+	    rpt.dates.push_back(dates[k].date);
+	return true;
+    }
+    int worst;
+    double ytw = toworst_yield(fy, dates, price, &worst);
+    if (ytw == FLOW_YIELD_ERROR)
+	return false;
+    rpt.dates.push_back(dates[worst].date);
+    rpt.yields.push_back(ytw);
+    rpt.worst = 0;
+    return true;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the report from AKABondValueYieldsEx() and
+	    AKAPriceToWorst()
+   Returns: false on a library error
+   ----------------------------------------------------------------- */
+inline bool
+to_worst_library(long pvdate, double price, const AKABOND *bond,
+		 ToWorstReport &rpt)
+{
+    AKABONDYIELDREPORT yr;
+    memset(&yr, 0, sizeof(yr));
+    rpt.library = true;
+    if (AKABondValueYieldsEx(pvdate, price, bond, 0, 0, &yr) != 0 ||
+	AKAError() != AKA_ERROR_NONE)
+	return false;
+    rpt.ytm = yr.ytm;
+    rpt.ytw = yr.ytw;
+    rpt.ytwdate = yr.worstdate;
+    rpt.modDurWorst = yr.modDurWorst;
+    rpt.modConWorst = yr.modConWorst;
+
+    AKAPRCWORST *pw = AKAPrcWorstReportAlloc();
+    bool ok = AKAPriceToWorst(pvdate, AKA_QUOTE_PRICE, price, bond, pw) == 0 &&
+	AKAError() == AKA_ERROR_NONE && pw->n > 0;
+    if (ok) {
+	rpt.ptw = pw->prices[pw->worst];
+	rpt.ptwdate = pw->dates[pw->worst];
+    }
+    AKAPrcWorstReportFree(pw);
+    return ok;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the yield and price to worst of a bond at a clean price,
+	    from one list of its dates.  fy is prepared for the bond
+	    here.
+   Returns: false on an error, see AKAError() if it is the library's
+   ----------------------------------------------------------------- */
+inline bool
+to_worst(long pvdate, double price, const AKABOND *bond, FlowYears &fy,
+	 ToWorstReport &rpt)
+{
+    if (!toworst_supported(bond))
+	return to_worst_library(pvdate, price, bond, rpt);
+    rpt.library = false;
+
+    std::vector<ToWorstDate> dates;
+    if (!fy.Prepare(pvdate, bond))
+	return false;
+    toworst_dates(fy, dates);
+    rpt.ytm = flow_yield(fy, dates.back().redemption, price,
+			 bond->sec->coupon);
+    int worst;
+    rpt.ytw = toworst_yield(fy, dates, price, &worst);
+    if (rpt.ytm == FLOW_YIELD_ERROR || rpt.ytw == FLOW_YIELD_ERROR)
+	return false;
+    rpt.ytwdate = dates[worst].date;
+    flow_value(fy, dates[worst].redemption, rpt.ytw, &rpt.modDurWorst,
+	       &rpt.modConWorst);
+
+	/* every date at the ytm, in one pass */
+    std::vector<size_t> all(dates.size());
+    for (size_t k = 0; k < dates.size(); k++)
+	all[k] = k;
+    std::vector<double> sums, slopes;
+    double value = 0, slope = 0;
+    size_t lowest = toworst_lowest(fy, dates, all, rpt.ytm, sums, slopes,
+				   &value, &slope);
+    rpt.ptw = value - fy.Accrued();
+    rpt.ptwdate = dates[lowest].date;
+    return true;
+}
+
+#endif // ifndef _TOWORST_HPP_
@@ -0,0 +1,132 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Tree fitting for a stream of curve updates which mostly barely
+   move.
+
+   TreeFitter keeps the last curve fitted and its tree.  Fit() of a
+   curve unchanged from it, to a tolerance, returns the same tree
+   without fitting.  With SetShiftFits(), a curve which differs from
+   it by one parallel move of the par rates is fitted from the last
+   tree by AKATreeFitShift(), the library's fit from an existing tree.
+   Any other curve is fitted from scratch by AKATreeFit().  Stats()
+   counts each kind of fit and the time spent fitting, so the savings
+   of a stream can be seen.
+
+   Shift fits start from the last tree rather than from the curve, so
+   over a long run of shifts the tree can drift from the curve given;
+   curvefit.cpp compares prices from both ways of fitting.
+   ------------------------------------------------------------------------- */
+#ifndef _TREEFITTER_HPP_
+#define _TREEFITTER_HPP_
+
+#include <math.h>
+
+#include <chrono>
+
+#include "akaapi.h"
+
+struct TreeFitStats {
+    long fits;			/* AKATreeFit() from scratch */
+    long shifts;		/* AKATreeFitShift() from the last tree */
+    long reused;		/* unchanged curves, no fit */
+    double seconds;		/* spent in fits and shifts */
+};
+
+class TreeFitter {
+private:     // disallow copy, assignment
+    TreeFitter(const TreeFitter &);
+    TreeFitter & operator=(const TreeFitter &);
+
+    AKACURVE *last;
+    AKAHTREE tree;
+    double tolerance;
+    bool shiftfits;
+    TreeFitStats stats;
+
+	/* Purpose: the parallel move of the par rates from last to curve
+	   Returns: true if all points moved by *move, 7% as 7.0 */
+    bool Parallel(const AKACURVE *curve, double *move) const {
+	if (last->n != curve->n || last->type != curve->type ||
+	    last->mode != curve->mode || last->vol != curve->vol ||
+	    last->lvol != curve->lvol || last->alpha != curve->alpha)
+	    return false;
+	*move = (curve->n > 0) ? curve->yield[0] - last->yield[0] : 0;
+	for (long i = 0; i < curve->n; i++) {
+	    if (last->time[i] != curve->time[i] ||
+		fabs(curve->yield[i] - last->yield[i] - *move) > tolerance)
+		return false;
+	}
+	return true;
+    };
+public:
+	/* tolerance is the largest difference of a rate treated as
+	   no difference, 7% as 7.0 */
+    TreeFitter(double tolerance = 1e-10)
+	: last(NULL), tree(0), tolerance(tolerance), shiftfits(false) {
+	Reset();
+    };
+    ~TreeFitter() {
+	if (tree != 0)
+	    AKATreeRelease(tree);
+	if (last != NULL)
+	    AKACurveFree(last);
+    };
+
+	// fit parallel moves of par curves from the last tree
+    void SetShiftFits(bool on) { shiftfits = on; };
+
+	/* Fit the curve, or reuse the last tree.  The tree returned is
+	   owned here, and is valid until the next Fit() or Reset().
+	   Returns 0 if the fit failed; AKAError() has the reason. */
+    AKAHTREE Fit(const AKACURVE *curve) {
+	double move = 0;
+	bool parallel = (last != NULL && tree != 0 && Parallel(curve, &move));
+	if (parallel && fabs(move) <= tolerance) {
+	    stats.reused++;
+	    return tree;
+	}
+
+	std::chrono::steady_clock::time_point start =
+	    std::chrono::steady_clock::now();
+	AKAHTREE fitted;
+	if (parallel && shiftfits && curve->type == AKA_CURVE_PAR) {
+	    fitted = AKATreeFitShift(tree, 100 * move, AKA_SHIFT_PAR);
+	    stats.shifts++;
+	}
+	else {
+	    fitted = AKATreeFit(curve, NULL);
+	    stats.fits++;
+	}
+	std::chrono::duration<double> elapsed =
+	    std::chrono::steady_clock::now() - start;
+	stats.seconds += elapsed.count();
+
+	if (tree != 0)
+	    AKATreeRelease(tree);
+	if (last != NULL)
+	    AKACurveFree(last);
+	tree = fitted;
+	last = (fitted != 0) ? AKACurveCopy(curve) : NULL;
+	return tree;
+    };
+
+	/* forget the last curve and tree, and clear Stats(); call it
+	   before AKA_shutdown() if the fitter outlives it */
+    void Reset() {
+	if (tree != 0)
+	    AKATreeRelease(tree);
+	if (last != NULL)
+	    AKACurveFree(last);
+	tree = 0;
+	last = NULL;
+	stats.fits = stats.shifts = stats.reused = 0;
+	stats.seconds = 0;
+    };
+
+    AKAHTREE Tree() const { return tree; };
+    const TreeFitStats &Stats() const { return stats; };
+};
+
+#endif // ifndef _TREEFITTER_HPP_
@@ -0,0 +1,264 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Building blocks for pipelined example programs: a bounded queue
+   between pipeline stages and a window which keeps the number of
+   records in flight, and therefore memory, constant.
+
+   Records are numbered in input order as they enter the pipeline.
+   The last stage uses the numbers to restore input order.
+
+   run_pipeline() puts them together into the three stages of the
+   streaming examples: one reader, a pool of workers, and a writer
+   which sees the records in input order.
+
+   parallel_for() is the batch counterpart: the items of a batch in
+   memory taken by a pool of threads from a shared counter.
+   ------------------------------------------------------------------------- */
+#ifndef _WORKQUEUE_HPP_
+#define _WORKQUEUE_HPP_
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+/* -----------------------------------------------------------------
+   A fixed capacity FIFO shared between threads.  Push() blocks while
+   the queue is full, Pop() blocks while it is empty.  After Close()
+   Push() fails and Pop() fails once the queue is drained.
+   ----------------------------------------------------------------- */
+template <class T>
+class BoundedQueue {
+private:     // disallow copy, assignment
+    BoundedQueue(const BoundedQueue &);
+    BoundedQueue & operator=(const BoundedQueue &);
+
+    std::mutex lock;
+    std::condition_variable notfull;
+    std::condition_variable notempty;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed;
+public:
+    BoundedQueue(size_t cap) : capacity(cap > 0 ? cap : 1), closed(false) {};
+
+	// returns false if the queue has been closed
+    bool Push(const T &item) {
+	std::unique_lock<std::mutex> guard(lock);
+	while (!closed && items.size() >= capacity)
+	    notfull.wait(guard);
+	if (closed)
+	    return false;
+	items.push_back(item);
+	notempty.notify_one();
+	return true;
+    };
+
+	// returns false if the queue is closed and empty
+    bool Pop(T &item) {
+	std::unique_lock<std::mutex> guard(lock);
+	while (!closed && items.empty())
+	    notempty.wait(guard);
+	if (items.empty())
+	    return false;
+	item = items.front();
+	items.pop_front();
+	notfull.notify_one();
+	return true;
+    };
+
+	// no more items will be pushed, wakes all waiting threads
+    void Close() {
+	std::unique_lock<std::mutex> guard(lock);
+	closed = true;
+	notfull.notify_all();
+	notempty.notify_all();
+    };
+};
+
+/* -----------------------------------------------------------------
+   Limits the records in flight to a window past the last record
+   written.  The first stage calls Acquire() with each record number
+   before reading the record; the last stage calls Release() as it
+   writes records in order.  Without the window a single slow record
+   would let the reorder buffer of the last stage grow without bound.
+   ----------------------------------------------------------------- */
+class SequenceWindow {
+private:     // disallow copy, assignment
+    SequenceWindow(const SequenceWindow &);
+    SequenceWindow & operator=(const SequenceWindow &);
+
+    std::mutex lock;
+    std::condition_variable moved;
+    long written;
+    long width;
+    bool closed;
+public:
+    SequenceWindow(long w) : written(0), width(w > 0 ? w : 1), closed(false) {};
+
+	// blocks until seq is within the window, false if closed
+    bool Acquire(long seq) {
+	std::unique_lock<std::mutex> guard(lock);
+	while (!closed && seq >= written + width)
+	    moved.wait(guard);
+	return !closed;
+    };
+
+	// records before seq have been written
+    void Release(long seq) {
+	std::unique_lock<std::mutex> guard(lock);
+	written = seq;
+	moved.notify_all();
+    };
+
+    void Close() {
+	std::unique_lock<std::mutex> guard(lock);
+	closed = true;
+	moved.notify_all();
+    };
+};
+
+/* -----------------------------------------------------------------
+   Restores input order in the last stage.  Put() takes records in any
+   order; Next() hands them back in sequence, returning false when
+   the next record in sequence has not arrived yet.
+   ----------------------------------------------------------------- */
+template <class T>
+class ReorderBuffer {
+private:
+    std::map<long, T> pending;
+    long next;
+public:
+    ReorderBuffer() : next(0) {};
+
+    void Put(long seq, const T &item) { pending[seq] = item; };
+
+    bool Next(T &item) {
+	typename std::map<long, T>::iterator first = pending.begin();
+	if (first == pending.end() || first->first != next)
+	    return false;
+	item = first->second;
+	pending.erase(first);
+	next++;
+	return true;
+    };
+
+	// sequence number of the next record to be handed back
+    long Sequence() const { return next; };
+    size_t Pending() const { return pending.size(); };
+};
+
+/* -----------------------------------------------------------------
+   Purpose: run fn(i, t) for i = 0..n-1 on nthreads threads, each
+	    taking the next i from a shared counter; t is the thread,
+	    0..nthreads-1, for state kept per thread.  One thread runs
+	    on the caller.
+   Returns: nothing
+   ----------------------------------------------------------------- */
+template <class Fn>
+inline void
+parallel_for(long n, int nthreads, Fn fn)
+{
+    std::atomic<long> next(0);
+    std::vector<std::thread> threads;
+    if (nthreads > n)
+	nthreads = (int) n;
+    if (nthreads <= 1) {
+	for (long i = 0; i < n; i++)
+	    fn(i, 0);
+	return;
+    }
+    for (int t = 0; t < nthreads; t++) {
+	threads.push_back(std::thread([&, t]() {
+	    long i;
+	    while ((i = next++) < n)
+		fn(i, t);
+	}));
+    }
+    for (int t = 0; t < nthreads; t++)
+	threads[t].join();
+}
+
+/* a record of run_pipeline() and its number in input order */
+template <class T>
+struct PipelineItem {
+    long seq;
+    T record;
+};
+
+/* -----------------------------------------------------------------
+   Purpose: run a record stream through three stages:
+	      read(T &)     -- one thread, fills the next record,
+			       returns false at the end of the input
+	      work(T &, t)  -- nthreads threads, records in any order;
+			       t is the thread, 0..nthreads-1, for
+			       state kept per thread
+	      write(T &)    -- the calling thread, records in input
+			       order
+	    with at most 2 * qsize + nthreads records in flight
+   Returns: number of records written
+   ----------------------------------------------------------------- */
+template <class T, class Read, class Work, class Write>
+long
+run_pipeline(int nthreads, int qsize, Read read, Work work, Write write)
+{
+    typedef BoundedQueue<PipelineItem<T> *> Queue;
+    if (nthreads < 1)
+	nthreads = 1;
+    if (qsize < 1)
+	qsize = 1;
+    Queue parsed(qsize);
+    Queue done(qsize);
+    SequenceWindow window(2 * qsize + nthreads);
+    std::atomic<int> running(nthreads);
+
+	/* the only closer of parsed, so Push() does not fail */
+    std::thread reader([&]() {
+	for (long seq = 0; window.Acquire(seq); seq++) {
+	    PipelineItem<T> *item = new PipelineItem<T>;
+	    item->seq = seq;
+	    if (!read(item->record)) {
+		delete item;
+		break;
+	    }
+	    parsed.Push(item);
+	}
+	parsed.Close();
+    });
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nthreads; t++)
+	workers.push_back(std::thread([&, t]() {
+	    PipelineItem<T> *item;
+	    while (parsed.Pop(item)) {
+		work(item->record, t);
+		done.Push(item);
+	    }
+	    if (--running == 0)
+		done.Close();
+	}));
+
+    ReorderBuffer<PipelineItem<T> *> reorder;
+    long written = 0;
+    PipelineItem<T> *item;
+    while (done.Pop(item)) {
+	reorder.Put(item->seq, item);
+	while (reorder.Next(item)) {
+	    write(item->record);
+	    delete item;
+	    written++;
+	}
+	window.Release(reorder.Sequence());
+    }
+
+    reader.join();
+    for (int t = 0; t < nthreads; t++)
+	workers[t].join();
+    return written;
+}
+
+#endif // ifndef _WORKQUEUE_HPP_
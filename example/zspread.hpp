@@ -0,0 +1,124 @@
+/* -------------------------------------------------------------------------
+ * Copyright (c) 2014, Andrew Kalotay Associates.  All rights reserved. *
+   This example code is provided to users of the AKA Library.
+
+   Z-spreads of many bonds off one zero volatility tree.
+
+   The Z-spread is the OAS of a bond on the tree of AKATreeFitZero().
+   With no volatility and no options the value of a bond is its
+   scheduled flows discounted at the spread, and AKABondOAS() needs
+   none of its lattice machinery.  zspread_prepare() reads the flows
+   of a bond and their year fractions once (see flowyears.hpp), and
+   the zero rate of the tree at each flow.  zspread_solve() then finds
+   the spread by Newton steps on the sum of AKADiscount() of the flows,
+   with the derivative taken in closed form from the zero rates.  Bonds
+   with a call, put, or sinking fund, whose value depends on exercise,
+   and any bond the steps do not settle, are solved by AKABondOAS() as
+   before.
+
+   zspread_batch() solves a portfolio on several threads.
+   ------------------------------------------------------------------------- */
+#ifndef _ZSPREAD_HPP_
+#define _ZSPREAD_HPP_
+
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include "akaapi.h"
+#include "flowyears.hpp"
+#include "workqueue.hpp"
+
+#define ZSPREAD_ERROR -99999	/* as returned by AKABondOAS() */
+#define ZSPREAD_MAXSTEPS 20
+
+/* the flows of a bond and the zero rates of the tree at them */
+struct ZSpreadFlows {
+    long pvdate;
+    const AKABOND *bond;
+    bool options;		/* solve with AKABondOAS() */
+    FlowYears years;		/* the flows, ACT/ACT from the pvdate */
+    std::vector<double> zeros;	/* semiannual zero rate, .05 as 5% */
+};
+
+/* -----------------------------------------------------------------
+   Purpose: read the flows of a bond and the tree's zero rates at them
+   Returns: false on a library error, see AKAError()
+   ----------------------------------------------------------------- */
+inline bool
+zspread_prepare(long pvdate, AKAHTREE tree, const AKABOND *bond,
+		ZSpreadFlows &f)
+{
+    f.pvdate = pvdate;
+    f.bond = bond;
+    f.zeros.clear();
+    f.options = (bond->call != NULL && bond->call->n > 0) ||
+	(bond->put != NULL && bond->put->n > 0) ||
+	(bond->sink != NULL && bond->sink->n > 0);
+    if (f.options)
+	return true;
+
+    if (!f.years.Prepare(pvdate, bond, AKA_DAYS_ACT_ACT))
+	return false;
+    for (size_t i = 0; i < f.years.Size(); i++) {
+	double t = f.years.Years(i);
+	double df = AKADiscount(tree, 0, 1, t);
+	f.zeros.push_back(t > 0 && df > 0 ? 2 * (pow(df, -.5 / t) - 1) : 0);
+    }
+    return true;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the Z-spread of the prepared bond at a clean price
+   Returns: spread in bp, ZSPREAD_ERROR on an error
+   ----------------------------------------------------------------- */
+inline double
+zspread_solve(AKAHTREE tree, const ZSpreadFlows &f, double price)
+{
+    const FlowYears &fy = f.years;
+    if (!f.options && fy.Size() > 0) {
+	double target = price + fy.Accrued();
+	double spread = 0;
+	for (int step = 0; step < ZSPREAD_MAXSTEPS; step++) {
+	    double value = 0, slope = 0;
+	    for (size_t i = 0; i < fy.Size(); i++) {
+		double pv = AKADiscount(tree, spread, fy.Flow(i), fy.Years(i));
+		value += pv;
+		slope -= pv * fy.Years(i) * 1e-4 /
+		    (1 + (f.zeros[i] + spread * 1e-4) / 2);
+	    }
+	    if (fabs(value - target) <= 1e-10 * target)
+		return spread;
+	    if (!(slope < 0))
+		break;
+	    spread -= (value - target) / slope;
+	}
+    }
+    double oas = AKABondOAS(f.pvdate, tree, f.bond, price);
+    return AKAError() == AKA_ERROR_NONE ? oas : ZSPREAD_ERROR;
+}
+
+/* -----------------------------------------------------------------
+   Purpose: the Z-spreads of n bonds at their clean prices, off the
+	    zero volatility tree, on nthreads threads
+   Returns: number of errors; spreads[i] is ZSPREAD_ERROR for each
+   ----------------------------------------------------------------- */
+inline long
+zspread_batch(long pvdate, AKAHTREE tree, const AKABOND *const *bonds,
+	      const double *prices, size_t n, int nthreads, double *spreads)
+{
+    std::atomic<long> failed(0);
+    std::vector<ZSpreadFlows> flows(std::max(nthreads, 1));
+
+    parallel_for((long) n, nthreads, [&](long i, int t) {
+	spreads[i] = zspread_prepare(pvdate, tree, bonds[i], flows[t]) ?
+	    zspread_solve(tree, flows[t], prices[i]) : ZSPREAD_ERROR;
+	if (spreads[i] == ZSPREAD_ERROR)
+	    failed++;
+    });
+    return failed;
+}
+
+#endif // ifndef _ZSPREAD_HPP_